@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -34,6 +35,26 @@ enum sdft_SignalTraits {
     SDFT_IMAG_ONLY
 };
 
+/**
+* \brief The kinds of sliding cosine transforms available through sdft_init_dct_from_buffers.
+*
+* Each kind computes the cosine transform in the real parts and the matching sine transform in the imaginary parts
+* of its complex coefficients.
+*/
+enum sdft_CosineKind {
+    /**
+    * Coefficient k holds sum_n x[n] * cos(pi/N * k * (n + 1/2)) + i * sum_n x[n] * sin(pi/N * k * (n + 1/2)),
+    * i.e. the DCT-II coefficient k and the DST-II coefficient k - 1 (the imaginary part of coefficient 0 is 0).
+    */
+    SDFT_DCT_II,
+    /**
+    * Coefficient k holds sum_n x[n] * cos(pi/N * (k + 1/2) * (n + 1/2))
+    *                  + i * sum_n x[n] * sin(pi/N * (k + 1/2) * (n + 1/2)),
+    * i.e. the DCT-IV and the DST-IV coefficient k.
+    */
+    SDFT_DCT_IV
+};
+
 /**
 * \brief Error codes returned by the functions of this library.
 */
@@ -53,8 +74,42 @@ enum sdft_Error {
     /**
     * The two sdft_State structs passed to sdft_init_combine were not combinable due to
     * different configuration parameters (e.g. different window sizes or signal traits).
+    * Also returned by sdft_init_paired for the same reasons.
     */
     SDFT_NOT_COMBINABLE,
+    /**
+    * The passed time constant of an exponential average was negative, not a number, or infinite where a finite one
+    * is required.
+    */
+    SDFT_INVALID_TIME_CONSTANT,
+    /**
+    * The passed hop size was too small (e.g. < 1).
+    */
+    SDFT_INVALID_HOP_SIZE,
+    /**
+    * The requested operation is not supported by the kind of the passed sdft_State struct.
+    */
+    SDFT_NOT_SUPPORTED,
+    /**
+    * The passed list of frequencies was empty or contained values which were not finite.
+    */
+    SDFT_INVALID_FREQUENCIES,
+    /**
+    * The passed decimation factor or filter length was too small (e.g. < 1).
+    */
+    SDFT_INVALID_FILTER,
+    /**
+    * The description of a pipeline was malformed or its stages could not be connected.
+    */
+    SDFT_INVALID_PIPELINE,
+    /**
+    * The passed sdft_FlatState was not initialized by sdft_init_flat or is corrupted.
+    */
+    SDFT_INVALID_FLAT_STATE,
+    /**
+    * A call to the operating system failed, errno holds the reason.
+    */
+    SDFT_SYSTEM_ERROR,
 };
 
 /**
@@ -104,11 +159,234 @@ enum sdft_Error sdft_init_from_buffers(
         size_t window_size,
         enum sdft_SignalTraits signal_traits);
 
+/**
+* \brief Initializes the sdft_State like sdft_init_from_buffers, but with a spectrum of n_bins arbitrary bins instead
+*        of the window_size bins of the DFT.
+*
+* Bin k of the spectrum equals
+*
+*     sum_j window[j] * exp(-2 * pi * i * bins[k] * j / window_size)
+*
+* over the temporally ordered window. The bins may be non-integral, e.g. bin 50.3 * window_size / sample_rate tracks
+* exactly 50.3 Hz. Each bin gets its own phase offset and a correction of the incoming sample, which accounts for the
+* non-integral number of periods in the window and costs one more complex multiplication per bin.
+* As the bins are arbitrary, signal_traits does not halve the spectrum but only restricts the allowed samples.
+* Two such states can be combined (see sdft_init_combine) or paired (see sdft_init_paired) if their bins match.
+*
+* \param state the state which is to be initialized.
+* \param precision the precision to use in floating point operations and buffers. Affects the buffer sizes.
+* \param window the sliding window buffer containing the initial signal. At least window_size complex elements.
+* \param spectrum the buffer containing the initial spectrum. At least n_bins complex elements.
+* \param phase_offsets a buffer for internal use whose content will be overwritten. At least 2*n_bins complex elements.
+* \param window_size the number of samples in the sliding window buffer.
+* \param signal_traits the guaranteed signal traits, see sdft_init_from_buffers.
+* \param bins the (possibly non-integral) bins to track, in cycles per window_size samples.
+* \param n_bins the number of elements of bins.
+* \returns an error code indicating success or failure.
+*          SDFT_WINDOW_TOO_SHORT: The window_size was too small (e.g. < 1).
+*          SDFT_SIGNAL_TRAIT_VIOLATION: The initial values in the window buffer didn't match the desired signal trait.
+*          SDFT_INVALID_FREQUENCIES: n_bins was 0 or one of the bins was not finite.
+*
+* Runtime: O(window_size + n_bins)
+*/
+enum sdft_Error sdft_init_from_bins(
+        struct sdft_State *state,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *spectrum,
+        void *phase_offsets,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        const double *bins,
+        size_t n_bins);
+
+/**
+* \brief Returns the window size needed by sdft_init_constant_q_from_buffers, which is the window length of the lowest
+*        bin, or 0 if the parameters are invalid.
+*/
+size_t sdft_constant_q_window_size(double min_frequency, size_t bins_per_octave);
+
+/**
+* \brief Initializes the sdft_State as a sliding constant-Q transform with logarithmically spaced bins.
+*
+* Bin k has the frequency f_k = min_frequency * 2^(k / bins_per_octave) (in cycles per sample) and its own window
+* length N_k = ceil(Q / f_k) with the quality factor Q = 1 / (2^(1 / bins_per_octave) - 1), so that each bin spans
+* Q periods. Bin k of the spectrum equals
+*
+*     sum_j x[j] * exp(-2 * pi * i * f_k * j)
+*
+* over the last N_k samples x, temporally ordered. All bins share one window ring of window_size samples, from which
+* each bin reads its outgoing sample at its own delay N_k. The values are not normalized; divide by lengths[k] to
+* compare bins of different lengths.
+*
+* \param state the state which is to be initialized.
+* \param precision the precision to use in floating point operations and buffers. Affects the buffer sizes.
+* \param window the sliding window buffer containing the initial signal. At least window_size complex elements.
+* \param spectrum a buffer receiving the spectrum, which is initialized from the window. At least n_bins complex
+*        elements.
+* \param coefficients a buffer for internal use whose content will be overwritten. At least 2*n_bins complex elements.
+* \param lengths a buffer receiving the window length N_k of each bin. At least n_bins elements.
+* \param window_size the number of samples in the sliding window buffer. At least
+*        sdft_constant_q_window_size(min_frequency, bins_per_octave).
+* \param signal_traits the guaranteed signal traits, see sdft_init_from_buffers. Only restricts the allowed samples.
+* \param min_frequency the frequency of the lowest bin in cycles per sample.
+* \param bins_per_octave the number of bins per doubling of the frequency.
+* \param n_bins the number of bins.
+* \returns an error code indicating success or failure.
+*          SDFT_WINDOW_TOO_SHORT: The window_size was smaller than the window length of the lowest bin.
+*          SDFT_SIGNAL_TRAIT_VIOLATION: The initial values in the window buffer didn't match the desired signal trait.
+*          SDFT_INVALID_FREQUENCIES: n_bins or bins_per_octave was 0 or min_frequency was not positive and finite.
+*
+* Runtime: O(sum of all N_k)
+*/
+enum sdft_Error sdft_init_constant_q_from_buffers(
+        struct sdft_State *state,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *spectrum,
+        void *coefficients,
+        size_t *lengths,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        double min_frequency,
+        size_t bins_per_octave,
+        size_t n_bins);
+
+/**
+* \brief Initializes the sdft_State as a sliding cosine (and sine) transform of a real signal.
+*
+* The state behaves like one initialized by sdft_init_from_buffers, but operates on real samples with a real window
+* buffer. Each sdft_push_next_sample updates all window_size coefficients by a real 2x2 rotation of the (cosine, sine)
+* pair and adds the real samples scaled by a precomputed weight, without going through the complex DFT. This costs six
+* real multiplications per coefficient for the DCT-II and eight for the DCT-IV, against four for a push to
+* sdft_init_from_buffers: the sine transform comes along with the cosine transform, so the state saves the complex
+* window rather than arithmetic. Two such states of matching precision, window size and kind can be combined with
+* sdft_init_combine.
+*
+* \param state the state which is to be initialized.
+* \param precision the precision to use in floating point operations and buffers. Affects the buffer sizes.
+* \param window the sliding window buffer containing the initial signal. At least window_size real elements.
+* \param coefficients the buffer containing the initial coefficients matching the window, in the format described by
+*        kind. At least window_size complex elements.
+* \param twiddles a buffer for internal use whose content will be overwritten. At least 2*window_size complex
+*        elements.
+* \param window_size the number of samples in the sliding window buffer and also the number of coefficients.
+* \param kind the kind of the transform.
+* \returns an error code indicating success or failure.
+*          SDFT_WINDOW_TOO_SHORT: The window_size was too small (e.g. < 1).
+*          SDFT_NOT_SUPPORTED: kind was not one of the values of sdft_CosineKind.
+* \see sdft_CosineKind
+*
+* Runtime: O(window_size)
+*/
+enum sdft_Error sdft_init_dct_from_buffers(
+        struct sdft_State *state,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *coefficients,
+        void *twiddles,
+        size_t window_size,
+        enum sdft_CosineKind kind);
+
+/**
+* \brief Initializes the sdft_State as a bank of sliding Goertzel detectors, one for each of the n_bins bins.
+*
+* Instead of the whole spectrum, the state only tracks the bins in the bins array, which may lie between the bins of
+* a window_size-point DFT (e.g. 3.25 is a quarter bin above bin 3). Coefficient k of the spectrum equals
+*
+*     sum_j window[j] * exp(-2 * pi * i * bins[k] * j / window_size)
+*
+* over the temporally ordered window, so for integral bins it matches the corresponding bin of
+* sdft_init_from_buffers. Each detector is a real second order resonator, which costs one real multiplication per
+* signal component and sample for integral bins and two for non-integral ones. The complex spectrum is only computed
+* by sdft_get_spectrum. The resonators of all detectors are kept in flat arrays, one per resonator variable, so that
+* sdft_push_next_sample runs the same simple loop over all of them. Two such states with matching precision, window
+* size, signal traits and bins can be combined with sdft_init_combine.
+*
+* If any bin is non-integral, the incoming and the outgoing samples drive separate undamped resonators, whose states
+* grow without bound while only the spectrum derived from their difference stays bounded. The same holds for the
+* resonators of integral bins at multiples of window_size/2 (e.g. 0), whose double pole at 1 resp. -1 the difference of
+* the samples only partly cancels. Such states restart their resonators from the window every window_size pushes, so
+* their precision does not decay with the number of pushes. The restart costs O(window_size * n_bins) at that push,
+* i.e. one more update of the resonators per push on average. The resonators of all other integral bins stay bounded
+* without restarts.
+*
+* \param state the state which is to be initialized.
+* \param precision the precision to use in floating point operations and buffers. Affects the buffer sizes.
+* \param window the sliding window buffer containing the initial signal. At least window_size complex elements.
+* \param spectrum a buffer receiving the spectrum in sdft_get_spectrum. At least n_bins complex elements.
+* \param coefficients a buffer for internal use whose content will be overwritten. At least 3*n_bins complex elements.
+* \param resonators a buffer for internal use whose content will be overwritten. At least 4*n_bins complex elements.
+* \param window_size the number of samples in the sliding window buffer.
+* \param signal_traits the guaranteed signal traits, see sdft_init_from_buffers. Purely real or purely imaginary signals
+*        halve the work, but do not restrict the bins.
+* \param bins the (possibly non-integral) bins to track, in cycles per window_size samples.
+* \param n_bins the number of elements of bins.
+* \returns an error code indicating success or failure.
+*          SDFT_WINDOW_TOO_SHORT: The window_size was too small (e.g. < 1).
+*          SDFT_SIGNAL_TRAIT_VIOLATION: The initial values in the window buffer didn't match the desired signal trait.
+*          SDFT_INVALID_FREQUENCIES: n_bins was 0 or one of the bins was not finite.
+*
+* Runtime: O(window_size * n_bins), because the detectors are primed with the initial window.
+*/
+enum sdft_Error sdft_init_goertzel_from_buffers(
+        struct sdft_State *state,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *spectrum,
+        void *coefficients,
+        void *resonators,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        const double *bins,
+        size_t n_bins);
+
+/**
+* \brief Initializes a sliding DFT with an exponentially decaying window instead of a rectangular one, which needs
+*        neither a window buffer nor the outgoing sample.
+*
+* Each bin is a leaky complex resonator, X_k = p_k * (X_k + x) with the pole p_k = lambda * exp(2 * pi * i * k /
+* window_size) and lambda = exp(-1 / time_constant), so coefficient k of the spectrum equals
+*
+*     sum_m lambda^(m + 1) * exp(2 * pi * i * k * (m + 1) / window_size) * x[n - m]
+*
+* over all samples x[n - m] pushed so far, newest first. For the most recent window_size samples and lambda = 1 this is
+* the spectrum of sdft_init_from_buffers. window_size only sets the spacing of the bins; the length of the window is
+* set by time_constant, and the spectrum of a sinusoid on a bin grows to about time_constant times its amplitude. As
+* the poles lie inside the unit circle, rounding errors decay as well, so the state does not need to be combined for
+* numerical stability (and cannot be). The state starts from silence, i.e. a zero spectrum. sdft_unshift_and_get_window
+* returns NULL, as there is no window. Averaging is supported.
+*
+* \param state the state which is to be initialized.
+* \param precision the precision to use in floating point operations and buffers. Affects the buffer sizes.
+* \param spectrum a buffer receiving the spectrum. At least as many complex elements as the state has bins, i.e.
+*        window_size for SDFT_REAL_AND_IMAG and window_size / 2 otherwise.
+* \param poles a buffer for internal use whose content will be overwritten. Same size as spectrum.
+* \param window_size the number of bins of a full spectrum, i.e. the bins lie at multiples of 1 / window_size cycles
+*        per sample.
+* \param signal_traits the guaranteed signal traits, see sdft_init_from_buffers.
+* \param time_constant the number of samples after which the weight of a sample has decayed to 1/e. Greater than 0 and finite.
+* \returns an error code indicating success or failure.
+*          SDFT_WINDOW_TOO_SHORT: The window_size was too small (e.g. < 1).
+*          SDFT_INVALID_TIME_CONSTANT: time_constant was not positive, not finite or NaN.
+*
+* Runtime: O(window_size)
+*/
+enum sdft_Error sdft_init_leaky_from_buffers(
+        struct sdft_State *state,
+        enum sdft_FloatPrecision precision,
+        void *spectrum,
+        void *poles,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        double time_constant);
+
 /**
 * \brief Combines two combinable sdft_State structs (the buffers of which must not overlap) for vastly increased
 *        numberical stability.
 *
-* Two states are combinable iff their floating point precision, signal trait and window sizes match.
+* Two states are combinable iff they are of the same kind (e.g. both initialized by sdft_init_from_buffers) and their
+* floating point precision, signal trait (resp. cosine kind), window sizes and (where applicable) bins match.
 * Upon successful initialization, the first struct is assumed to contain the initial values and the buffers
 * of the second struct are reset.
 *
@@ -162,6 +440,277 @@ enum sdft_Error sdft_init_combine(
         struct sdft_State *first,
         struct sdft_State *second);
 
+/**
+* \brief Initializes a combined state on the bins of the DFT like sdft_init_combine does for two states initialized by
+*        sdft_init_from_buffers, but with a single window and phase offset buffer shared by both spectra.
+*
+* This takes half the memory of two separate states, and both spectra are updated in a single loop which loads each
+* phase offset once, which roughly halves the memory traffic per pushed sample. The results are the same as those of
+* sdft_init_combine.
+*
+* \param state the allocated sdft_State struct which is initialized by this function.
+* \param precision the precision to use in floating point operations and buffers. Affects the buffer sizes.
+* \param window the sliding window buffer containing the initial signal. At least window_size complex elements.
+* \param spectra the buffer for both spectra, the first window_size complex elements of which contain the initial
+*        spectrum. At least 2*window_size complex elements.
+* \param phase_offsets a buffer for internal use whose content will be overwritten. At least window_size complex
+*        elements.
+* \param window_size the number of samples in the sliding window buffer.
+* \param signal_traits the guaranteed signal traits, see sdft_init_from_buffers.
+* \returns an error code indicating success or failure.
+*          SDFT_WINDOW_TOO_SHORT: The window_size was too small (e.g. < 1).
+*          SDFT_SIGNAL_TRAIT_VIOLATION: The initial window violated signal_traits.
+*
+* Runtime: O(window_size)
+*/
+enum sdft_Error sdft_init_shared_combined(
+        struct sdft_State *state,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *spectra,
+        void *phase_offsets,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits);
+
+/**
+* \brief The kinds of states which can be stored as sdft_FlatState.
+*/
+enum sdft_FlatKind {
+    /**
+    * A state on the bins of the DFT, like one initialized by sdft_init_from_buffers.
+    */
+    SDFT_FLAT_PLAIN,
+    /**
+    * A combined state on the bins of the DFT, like one initialized by sdft_init_shared_combined.
+    */
+    SDFT_FLAT_COMBINED
+};
+
+/**
+* \brief The magic number at the start of each sdft_FlatState.
+*/
+#define SDFT_FLAT_MAGIC 0x54464453u
+
+/**
+* \brief A state stored in a single, position-independent block of memory, which starts with this header.
+*
+* In contrast to a sdft_State, the block holds the complete state including its buffers, refers to them by offsets
+* relative to its start and contains no pointers. It can thus be copied with memcpy, moved, written to and mapped from
+* files, or placed in memory shared between processes, as long as all users agree on the ABI (e.g. the size of long
+* double). It is accessed through a sdft_State handle created by sdft_init_from_flat, which is local to the process.
+* All fields are maintained by the library and should be treated as read-only.
+*/
+struct sdft_FlatState {
+    /**
+    * SDFT_FLAT_MAGIC.
+    */
+    uint32_t magic;
+    /**
+    * The enum sdft_FloatPrecision, enum sdft_FlatKind and enum sdft_SignalTraits of the state.
+    */
+    uint32_t precision;
+    uint32_t kind;
+    uint32_t signal_traits;
+    /**
+    * The size of the whole block in bytes, see sdft_flat_size.
+    */
+    uint64_t size;
+    uint64_t window_size;
+    /**
+    * The position of the oldest sample in the window ring.
+    */
+    uint64_t window_index;
+    /**
+    * The number of pushes since the last clear of a spectrum of a SDFT_FLAT_COMBINED state.
+    */
+    uint64_t clear_counter;
+    /**
+    * The offsets of the window, the spectra (one or two, window_size complex elements each) and the phase offsets in
+    * bytes from the start of the block.
+    */
+    uint64_t window_offset;
+    uint64_t spectra_offset;
+    uint64_t phase_offsets_offset;
+};
+
+/**
+* \brief Returns the size in bytes of a sdft_FlatState block with the given parameters, or 0 if window_size is too
+*        large for the block to be addressable.
+*/
+size_t sdft_flat_size(enum sdft_FloatPrecision precision, size_t window_size, enum sdft_FlatKind kind);
+
+/**
+* \brief Initializes a sdft_FlatState block with a zero window and spectrum.
+*
+* \param flat the block, at least sdft_flat_size(precision, window_size, kind) bytes, aligned to 64 bytes for the
+*        best performance and at least suitably for long double.
+* \param precision the precision to use in floating point operations and buffers.
+* \param window_size the number of samples in the sliding window.
+* \param signal_traits the guaranteed signal traits, see sdft_init_from_buffers.
+* \param kind the kind of the state.
+* \returns an error code indicating success or failure.
+*          SDFT_WINDOW_TOO_SHORT: The window_size was too small (e.g. < 1).
+*          SDFT_NOT_SUPPORTED: The window_size was too large, i.e. sdft_flat_size returns 0 for it.
+*
+* Runtime: O(window_size)
+*/
+enum sdft_Error sdft_init_flat(
+        struct sdft_FlatState *flat,
+        enum sdft_FloatPrecision precision,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        enum sdft_FlatKind kind);
+
+/**
+* \brief Initializes state as a handle to the sdft_FlatState block flat, which can be used with all functions taking
+*        a sdft_State.
+*
+* The handle keeps no state of its own besides a pointer to flat and the settings of sdft_enable_averaging and
+* sdft_enable_latency_histogram, so any number of handles may be created for a block, e.g. after it has been moved or
+* mapped into another process. Only one handle at a time may push samples.
+*
+* \param state the allocated sdft_State struct which is initialized by this function.
+* \param flat the initialized block.
+* \returns an error code indicating success or failure.
+*          SDFT_INVALID_FLAT_STATE: flat was not initialized by sdft_init_flat or its header is corrupted.
+*          SDFT_SIGNAL_TRAIT_VIOLATION: The window violated the signal traits of flat.
+*
+* Runtime: O(window_size)
+*/
+enum sdft_Error sdft_init_from_flat(struct sdft_State *state, struct sdft_FlatState *flat);
+
+/**
+* \brief Returns the valid spectrum of a flat state without a handle, e.g. for read-only mappings.
+*
+* \returns sdft_get_number_of_bins complex elements of the precision of the state.
+*/
+const void *sdft_flat_get_spectrum(const struct sdft_FlatState *flat);
+
+/**
+* \brief Pairs two combinable sdft_State structs (the buffers of which must not overlap) into a state that pushes
+*        two synchronized channels x and y at once and maintains exponentially averaged auto- and cross-spectra.
+*
+* Two states are pairable iff they are combinable in the sense of sdft_init_combine and neither of them is a
+* combined state. After pairing, sdft_push_next_sample expects next_sample to point to two consecutive complex
+* numbers, the first being the next sample of x (stored in first) and the second being that of y (stored in second).
+* Both spectra and the averages are updated in a single pass over the bins, loading each phase offset only once.
+*
+* In each time step, with X and Y being the current spectra and alpha = 1 - exp(-1 / time_constant), the averages
+* are updated bin-wise as
+*
+*     Sxx = Sxx + alpha * (|X|^2 - Sxx)
+*     Syy = Syy + alpha * (|Y|^2 - Syy)
+*     Sxy = Sxy + alpha * (X * conj(Y) - Sxy)
+*
+* and initialized from the initial spectra of first and second. A time_constant of 0 disables averaging.
+* The spectra of the paired states stay accessible through first and second, sdft_get_spectrum on the paired state
+* returns Sxy.
+*
+* \param state the allocated sdft_State struct which is initialized by this function.
+* \param first the sdft_State struct of channel x. Must be pairable with second.
+* \param second the sdft_State struct of channel y. Must be pairable with first.
+* \param cross_spectrum a buffer receiving Sxy. At least as many complex elements as the spectra of first and second.
+* \param auto_spectra a buffer receiving Sxx followed by Syy. At least twice as many floating point elements (of the
+*        precision of first and second) as the spectra of first and second have complex elements.
+* \param time_constant the time constant of the exponential averages in number of pushed samples.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_NOT_COMBINABLE: second and first were not pairable because of a mismatch in precision, signal traits
+*                               or window sizes.
+*          SDFT_INVALID_TIME_CONSTANT: time_constant was negative or NaN.
+* \see sdft_get_cross_spectrum, sdft_get_auto_spectrum, sdft_get_coherence
+*
+* Runtime: O(window_size)
+*/
+enum sdft_Error sdft_init_paired(
+        struct sdft_State *state,
+        struct sdft_State *first,
+        struct sdft_State *second,
+        void *cross_spectrum,
+        void *auto_spectra,
+        double time_constant);
+
+/**
+* \brief Puts a decimating low-pass filter in front of an initialized sdft_State, so that the inner state runs at a
+*        factor times lower sample rate.
+*
+* Samples are pushed into the decimating state at the input rate. Every factor-th push, one sample of the low-pass
+* filtered signal is pushed into inner, which makes the decimating state roughly factor times cheaper than running
+* inner at the input rate. Only the filter outputs which are actually pushed into inner are computed, which costs
+* taps_per_phase multiplications per input sample, just like a polyphase implementation.
+*
+* The filter is a Blackman windowed sinc low-pass of factor*taps_per_phase taps with its cutoff at the Nyquist
+* frequency of the decimated rate (0.5 / factor cycles per input sample), normalized to unit gain at DC. It delays the
+* signal by (factor*taps_per_phase - 1) / 2 input samples. The bins close to the Nyquist frequency of inner are in the
+* transition band of the filter and thus attenuated. The frequency of bin k in cycles per input sample is that of
+* inner (taken from [-0.5, 0.5)) divided by factor, see sdft_get_bin_frequency.
+*
+* sdft_get_spectrum and sdft_unshift_and_get_window return those of inner, i.e. of the decimated signal.
+* sdft_push_next_sample always expects a complex sample. If inner is a sliding cosine transform, only the real part of
+* the filtered signal is used. Otherwise, as the filter keeps the signal traits, samples which violate those of inner
+* are rejected with SDFT_SIGNAL_TRAIT_VIOLATION before they enter the filter.
+*
+* \param state the allocated sdft_State struct which is initialized by this function.
+* \param inner an initialized state of any kind but paired, which receives the decimated signal.
+* \param factor the decimation factor.
+* \param taps_per_phase the number of filter taps per output sample and polyphase branch.
+* \param taps a buffer receiving the filter taps. At least factor*taps_per_phase real floating point elements of the
+*        precision of inner.
+* \param history a buffer for internal use whose content will be overwritten. At least 2*factor*taps_per_phase
+*        complex elements of the precision of inner.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_INVALID_FILTER: factor or taps_per_phase was < 1.
+*          SDFT_NOT_SUPPORTED: inner was a paired state.
+*
+* Runtime: O(factor * taps_per_phase)
+*/
+enum sdft_Error sdft_init_decimating(
+        struct sdft_State *state,
+        struct sdft_State *inner,
+        size_t factor,
+        size_t taps_per_phase,
+        void *taps,
+        void *history);
+
+/**
+* \brief Like sdft_init_decimating, but mixes the signal down by center_frequency before filtering, so that inner
+*        analyzes the narrow band of width 1 / factor (in cycles per input sample) around center_frequency.
+*
+* Each pushed sample is multiplied with exp(-2 * pi * i * center_frequency * n), where n counts the pushed samples, by
+* a numerically controlled oscillator. The resulting complex baseband signal is low-pass filtered and decimated as
+* described in sdft_init_decimating, so bin 0 of inner is at center_frequency and the resolution of inner is factor
+* times finer than at the input rate. Unless center_frequency is 0, inner has to accept complex samples, i.e. has to be
+* initialized with SDFT_REAL_AND_IMAG and must not be a cosine state. sdft_get_bin_frequency takes the mixing into
+* account.
+*
+* \param state the allocated sdft_State struct which is initialized by this function.
+* \param inner an initialized state accepting complex samples, which receives the decimated baseband signal.
+* \param center_frequency the center of the analyzed band in cycles per input sample.
+* \param factor the decimation factor.
+* \param taps_per_phase the number of filter taps per output sample and polyphase branch.
+* \param taps a buffer receiving the filter taps. At least factor*taps_per_phase real floating point elements of the
+*        precision of inner.
+* \param history a buffer for internal use whose content will be overwritten. At least 2*factor*taps_per_phase
+*        complex elements of the precision of inner.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_INVALID_FILTER: factor or taps_per_phase was < 1.
+*          SDFT_INVALID_FREQUENCIES: center_frequency was not finite.
+*          SDFT_NOT_SUPPORTED: inner was a paired state, or center_frequency was not 0 and inner did not accept
+*                              complex samples.
+*
+* Runtime: O(factor * taps_per_phase)
+*/
+enum sdft_Error sdft_init_zoom(
+        struct sdft_State *state,
+        struct sdft_State *inner,
+        double center_frequency,
+        size_t factor,
+        size_t taps_per_phase,
+        void *taps,
+        void *history);
+
 /**
 * \brief Pushes a fresh sample through the sDFT and updates the spectrum, which is immediately usable.
 *
@@ -171,17 +720,112 @@ enum sdft_Error sdft_init_combine(
 *
 * \param state the internal state, which has to be initialized with sdft_init prior to usage.
 * \param next_sample a pointer the next sample, which is assumed to be a single complex number in the format
-*        described in sdft_init.
+*        described in sdft_init. States initialized by sdft_init_dct_from_buffers expect a single real number.
 *
-* Runtime: O(window_size)
+* Runtime: O(window_size), O(1) if lazy rotation is enabled, next_sample equals the sample leaving the window and no
+*          averaged power is due, see sdft_enable_lazy_rotation.
 */
 enum sdft_Error sdft_push_next_sample(struct sdft_State *state, void *next_sample);
 
+/**
+* \brief Advances the state by n_samples samples of the value fill, e.g. to bridge a gap in the signal, with the same
+*        result as pushing them one by one.
+*
+* States of sdft_init_from_buffers on the bins of the DFT, also when combined, compute the new spectrum in closed form
+* from the samples which remain in the window, or from those which leave it, whichever are fewer, or by an FFT of the
+* new window if that is cheaper. With n_samples of at least window_size, the window holds nothing but fill afterwards.
+* Combined states of any kind only skip the last 2*window_size to 4*window_size samples of a longer gap, as the samples
+* before do not matter after the restarts of their sub-states. If averaging is enabled, all updates of the averaged
+* power which fall into the skipped samples are made with the spectrum after them.
+*
+* \param state the internal state, which has to be initialized with sdft_init prior to usage.
+* \param n_samples the number of samples to skip.
+* \param fill a pointer to the sample to repeat, in the format of sdft_push_next_sample, or NULL for zero samples.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_SIGNAL_TRAIT_VIOLATION: fill violated the signal traits of the state.
+*
+* Runtime: O(window_size * min(n_samples, window_size - n_samples, log(window_size))) for n_samples < window_size and
+*          power-of-two window sizes, O(window_size * min(n_samples, window_size - n_samples)) for other window sizes,
+*          and O(window_size) for n_samples >= window_size, for states of sdft_init_from_buffers on the bins of the
+*          DFT. O(min(n_samples, 4 * window_size) * window_size) for other combined states, O(n_samples * window_size)
+*          for all others.
+*/
+enum sdft_Error sdft_skip_samples(struct sdft_State *state, size_t n_samples, const void *fill);
+
+/**
+* \brief Pushes n_samples samples of which only the state after the last one is needed, e.g. to catch up with a
+*        backlog after a stall.
+*
+* If n_samples is at least the window size, states of sdft_init_from_buffers, also when combined, skip all but the
+* last window_size samples and recompute the spectrum from the window: for the bins of the DFT with an FFT if the window
+* size is a power of two and with a DFT otherwise, for other bins by pushing the window into the cleared state. As only
+* they end up in the
+* window, only the last window_size samples are checked against the signal traits then. Shorter blocks, and the blocks
+* of all other kinds of states, are pushed sample by sample. If averaging is enabled, all updates of the averaged power
+* which fall into the block are made with the spectrum after it.
+*
+* \param state the internal state, which has to be initialized with sdft_init prior to usage.
+* \param samples n_samples consecutive samples in the format of sdft_push_next_sample.
+* \param n_samples the number of samples.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_SIGNAL_TRAIT_VIOLATION: one of the samples violated the signal traits of the state. The samples which
+*                                       are used are checked before any of them is pushed, so the state is left
+*                                       unchanged then.
+*
+* Runtime: O(window_size * log(window_size)) for states of sdft_init_from_buffers on the bins of the DFT, window sizes
+*          which are powers of two and n_samples >= window_size, O(min(n_samples, window_size) * window_size)
+*          otherwise for states of sdft_init_from_buffers, O(n_samples * window_size) for all others.
+*/
+enum sdft_Error sdft_catch_up(struct sdft_State *state, const void *samples, size_t n_samples);
+
+/**
+* \brief Checks samples against the signal traits of a state without pushing them.
+*
+* \param state the internal state, which has to be initialized with sdft_init prior to usage.
+* \param samples n_samples consecutive samples in the format of sdft_push_next_sample.
+* \param n_samples the number of samples.
+*
+* \returns an error code indicating whether the samples could be pushed.
+*          SDFT_SIGNAL_TRAIT_VIOLATION: one of the samples violated the signal traits of the state.
+*
+* Runtime: O(n_samples)
+*/
+enum sdft_Error sdft_check_samples(struct sdft_State *state, const void *samples, size_t n_samples);
+
+/**
+* \brief Changes the window size of a state on the bins of the DFT without losing its history.
+*
+* The most recent min(old, new) window size samples are carried over to the end of the new window, preceded by zeros
+* if the window grows, the phase offsets are generated for the new window size and the spectrum is recomputed from the
+* window once, with an FFT if the new window size is a power of two. The signal traits stay the same. Averaging is
+* disabled, as its buffer has the old number of bins, and has to be enabled again with sdft_enable_averaging.
+*
+* \param state a state of sdft_init_from_buffers, or a combination of two of them.
+* \param window_size the new window size.
+* \param window, spectrum, phase_offsets the buffers for the new window size, see sdft_init_from_buffers, which must
+*        not overlap the current ones. The current buffers are no longer used afterwards. For a combined state, each
+*        of them holds the buffers of both sub-states, the second one starting at element window_size.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_WINDOW_TOO_SHORT: The window_size was too small (e.g. < 1).
+*          SDFT_NOT_SUPPORTED: the state is of another kind, including states of sdft_init_from_bins, shared
+*          combined and flat states.
+*
+* Runtime: O(window_size * log(window_size)) for window sizes which are powers of two, O(window_size^2) otherwise.
+*/
+enum sdft_Error sdft_resize(struct sdft_State *state, size_t window_size, void *window, void *spectrum,
+        void *phase_offsets);
+
 /**
 * \brief Returns a pointer to the current spectrum buffer.
 *
 * For same states, the result of this function may change after invocations of sdft_push_next_sample if state
 * is initialized as combined.
+*
+* If lazy rotation is enabled, call it again after pushing instead of keeping the pointer, see
+* sdft_enable_lazy_rotation.
 */
 void *sdft_get_spectrum(struct sdft_State *state);
 
@@ -197,6 +841,197 @@ void *sdft_get_spectrum(struct sdft_State *state);
 */
 void *sdft_unshift_and_get_window(struct sdft_State *state);
 
+/**
+* \brief Returns the floating point precision of an initialized state, i.e. of the numbers in its buffers.
+*/
+enum sdft_FloatPrecision sdft_get_precision(struct sdft_State *state);
+
+/**
+* \brief Returns the size in bytes of a sample passed to sdft_push_next_sample, e.g. two complex numbers for paired
+*        states and one real number for states of sdft_init_dct_from_buffers.
+*/
+size_t sdft_get_sample_size(struct sdft_State *state);
+
+/**
+* \brief Returns the number of usable complex elements in the spectrum returned by sdft_get_spectrum.
+*
+* E.g. window_size / 2 for states initialized by sdft_init_from_buffers with SDFT_REAL_ONLY.
+*/
+size_t sdft_get_number_of_bins(struct sdft_State *state);
+
+/**
+* \brief Returns the frequency of a bin of the spectrum in cycles per pushed sample, i.e. relative to the sample rate of
+*        the signal passed to sdft_push_next_sample, or NaN if the state has no such bin.
+*
+* Multiply by the sample rate to get the frequency in Hz. Frequencies above the Nyquist frequency (0.5) are the
+* aliases of negative frequencies.
+*/
+double sdft_get_bin_frequency(struct sdft_State *state, size_t bin);
+
+/**
+* \brief Returns a pointer to the averaged cross-spectrum Sxy of a paired state, or NULL for other states.
+*
+* \see sdft_init_paired
+*/
+void *sdft_get_cross_spectrum(struct sdft_State *state);
+
+/**
+* \brief Returns a pointer to the averaged auto-spectrum Sxx (channel == 0) or Syy (channel == 1) of a paired state,
+*        or NULL for other states and channels.
+*
+* The returned buffer contains real floating point numbers of the precision of the paired state.
+*
+* \see sdft_init_paired
+*/
+void *sdft_get_auto_spectrum(struct sdft_State *state, size_t channel);
+
+/**
+* \brief Computes the magnitude-squared coherence |Sxy|^2 / (Sxx * Syy) of a paired state.
+*
+* Bins in which one of the auto-spectra vanishes get a coherence of 0.
+*
+* \param state a paired state.
+* \param coherence a buffer receiving the coherence of each bin as real floating point numbers of the precision of
+*        the paired state. At least as many elements as the cross-spectrum.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_NOT_SUPPORTED: state is not a paired state.
+*
+* Runtime: O(window_size)
+*/
+enum sdft_Error sdft_get_coherence(struct sdft_State *state, void *coherence);
+
+/**
+* \brief Enables an exponentially averaged power spectrum which is maintained by sdft_push_next_sample.
+*
+* Every hop_size-th call to sdft_push_next_sample updates the average bin-wise as
+*
+*     P = P + alpha * (|X|^2 - P)
+*
+* where X is the updated spectrum and alpha = 1 - exp(-1 / time_constant), so time_constant is measured in hops.
+* For plain states, this happens inside the same loop that updates the spectrum. The average is initialized from the
+* current spectrum. A time_constant of 0 makes the average follow the instantaneous power at each hop.
+*
+* \param state an initialized plain or combined state. Paired states maintain their own averages.
+* \param averaged_power a buffer receiving the averaged power as real floating point numbers of the precision of
+*        state. At least as many elements as the spectrum has complex elements. Pass NULL to disable averaging.
+* \param time_constant the time constant of the exponential average in number of hops.
+* \param hop_size the number of pushed samples between two updates of the average. At least 1.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_INVALID_TIME_CONSTANT: time_constant was negative or NaN.
+*          SDFT_INVALID_HOP_SIZE: hop_size was < 1.
+*          SDFT_NOT_SUPPORTED: state does not support averaging.
+* \see sdft_get_averaged_power
+*
+* Runtime: O(window_size)
+*/
+enum sdft_Error sdft_enable_averaging(
+        struct sdft_State *state,
+        void *averaged_power,
+        double time_constant,
+        size_t hop_size);
+
+/**
+* \brief Returns a pointer to the averaged power spectrum, or NULL if averaging is not enabled.
+*
+* \see sdft_enable_averaging
+*/
+void *sdft_get_averaged_power(struct sdft_State *state);
+
+/**
+* \brief Enables or disables lazy rotation of the spectrum by sdft_push_next_sample.
+*
+* A push whose incoming sample equals the outgoing one, e.g. during silence, only rotates every bin of the spectrum.
+* With lazy rotation, such pushes are merely counted in O(1), and the rotation they amount to is applied by the next
+* push of another sample or by sdft_get_spectrum. The spectrum buffer is then only up to date after a call to
+* sdft_get_spectrum, so the pointer must not be kept across pushes. Lazy rotation is disabled by default, which keeps
+* the spectrum buffer usable right after every push. Disabling it applies the pending rotation.
+*
+* \param state an initialized plain state on the bins of the DFT, or a combined state of two such states.
+* \param enable non-zero to enable lazy rotation, zero to disable it.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_NOT_SUPPORTED: state does not support lazy rotation, e.g. because it is on arbitrary bins.
+*
+* Runtime: O(1), O(window_size) when disabled with a pending rotation
+*/
+enum sdft_Error sdft_enable_lazy_rotation(struct sdft_State *state, int enable);
+
+/**
+* \brief The number of buckets of a sdft_LatencyHistogram.
+*/
+#define SDFT_LATENCY_BUCKETS 976
+
+/**
+* \brief A histogram of push latencies in ticks, see sdft_get_latency_tick_rate.
+*
+* The buckets are log-linear like those of an HDR histogram: values below 16 have a bucket of their own, larger values
+* are split into 16 buckets per power of two, so each bucket is at most 1/16 of its lower bound wide. The histogram is
+* a plain struct, which may be allocated anywhere and zero-initialized instead of calling sdft_reset_latency_histogram.
+*/
+struct sdft_LatencyHistogram {
+    unsigned long long counts[SDFT_LATENCY_BUCKETS];
+    /**
+    * The number of recorded latencies, i.e. the sum of counts.
+    */
+    unsigned long long total_count;
+    /**
+    * The smallest and largest recorded latency. min is ~0ull if nothing was recorded.
+    */
+    unsigned long long min;
+    unsigned long long max;
+};
+
+/**
+* \brief Records the latency of every sample_interval-th call to sdft_push_next_sample on state into histogram.
+*
+* The latency is taken from the time stamp counter on x86 and from a monotonic clock in nanoseconds elsewhere, which
+* costs a few nanoseconds per recorded push. Sampling keeps this overhead small, e.g. a sample_interval of 64 amortizes
+* it over 64 pushes. Wrapping states like combined or decimating ones record only their own pushes, not those of their
+* sub-states. The same histogram may be shared by states which are pushed on the same thread.
+*
+* \param state an initialized state.
+* \param histogram the histogram, which is not reset by this function. Pass NULL to disable recording.
+* \param sample_interval the number of pushes per recorded latency. At least 1.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_INVALID_HOP_SIZE: sample_interval was < 1.
+*/
+enum sdft_Error sdft_enable_latency_histogram(
+        struct sdft_State *state,
+        struct sdft_LatencyHistogram *histogram,
+        size_t sample_interval);
+
+/**
+* \brief Clears all recorded latencies of histogram.
+*/
+void sdft_reset_latency_histogram(struct sdft_LatencyHistogram *histogram);
+
+/**
+* \brief Adds the recorded latencies of from to those of into, e.g. to aggregate the histograms of several states.
+*/
+void sdft_merge_latency_histograms(struct sdft_LatencyHistogram *into, const struct sdft_LatencyHistogram *from);
+
+/**
+* \brief Returns an upper bound of the given percentile of the recorded latencies in ticks, which exceeds it by at most
+*        1/16.
+*
+* \param histogram the histogram.
+* \param percentile the percentile in [0, 100], e.g. 99.9.
+*
+* \returns the latency in ticks, or 0 if nothing was recorded or percentile is not in [0, 100], e.g. NaN.
+*/
+unsigned long long sdft_get_latency_percentile(const struct sdft_LatencyHistogram *histogram, double percentile);
+
+/**
+* \brief Returns the number of latency ticks per second.
+*
+* The rate of the time stamp counter is measured against a monotonic clock once, which blocks the first call for about
+* 10 milliseconds.
+*/
+double sdft_get_latency_tick_rate();
+
 #ifdef __cplusplus
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "sdft/sdft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* \brief The maximum number of band edges of a SDFT_STAGE_BANDS stage.
+*/
+#define SDFT_MAX_BAND_EDGES 65
+
+/**
+* \brief An opaque struct holding the configuration and state of a pipeline between calls to sdft_pipeline_process.
+*/
+struct sdft_Pipeline;
+
+/**
+* \brief The formats of the interleaved frames passed to sdft_pipeline_process.
+*/
+enum sdft_SampleFormat {
+    /**
+    * Signed 16 bit integers, scaled to [-1, 1).
+    */
+    SDFT_PCM_S16,
+    /**
+    * Signed 32 bit integers, scaled to [-1, 1).
+    */
+    SDFT_PCM_S32,
+    /**
+    * 32 bit floating point numbers.
+    */
+    SDFT_PCM_F32,
+    /**
+    * 64 bit floating point numbers.
+    */
+    SDFT_PCM_F64
+};
+
+/**
+* \brief The kinds of stages a pipeline is made of.
+*
+* A pipeline consists of any number of conditioning stages, exactly one SDFT_STAGE_TRANSFORM and any number of
+* reducers and sinks, in this order. Conditioning stages are applied to each sample, reducers and sinks run once per
+* hop. Each reducer and sink consumes the output of the closest reducer (or the transform) before it.
+*/
+enum sdft_StageKind {
+    /**
+    * Conditioning: multiplies each sample by parameter, which has to be finite. Config: "gain <parameter>".
+    */
+    SDFT_STAGE_GAIN,
+    /**
+    * Conditioning: removes the DC offset with y[n] = x[n] - x[n-1] + parameter * y[n-1]. parameter is the pole of the
+    * filter inside (-1, 1), e.g. 0.995. Config: "dc <parameter>".
+    */
+    SDFT_STAGE_DC_REMOVAL,
+    /**
+    * Pushes each conditioned sample into the state and runs the following stages every parameter samples, on the
+    * spectrum (sdft_get_number_of_bins complex elements of the precision of the state). Config: "sdft <parameter>".
+    */
+    SDFT_STAGE_TRANSFORM,
+    /**
+    * Reducer: the power |X|^2 of each bin as doubles. Config: "power".
+    */
+    SDFT_STAGE_POWER,
+    /**
+    * Reducer: the summed power of the bins in [band_edges[i], band_edges[i + 1]) of each of the n_band_edges - 1
+    * bands as doubles. Config: "bands <edge> <edge> ...".
+    */
+    SDFT_STAGE_BANDS,
+    /**
+    * Sink: passes the output of the previous stage to the sink function with the index parameter.
+    * Config: "sink <parameter>".
+    */
+    SDFT_STAGE_SINK
+};
+
+/**
+* \brief The description of a single stage of a pipeline.
+*/
+struct sdft_Stage {
+    enum sdft_StageKind kind;
+    /**
+    * The parameter of the stage as described in sdft_StageKind.
+    */
+    double parameter;
+    size_t n_band_edges;
+    size_t band_edges[SDFT_MAX_BAND_EDGES];
+};
+
+/**
+* \brief A sink of a pipeline, which receives the output of the previous stage.
+*
+* \param user_data the pointer registered together with the sink.
+* \param data the output of the previous stage, which is only valid during the call.
+* \param n_elements the number of (complex or double) elements of data.
+* \param n_samples the number of samples pushed into the state so far.
+*/
+typedef void (*sdft_Sink)(void *user_data, const void *data, size_t n_elements, unsigned long long n_samples);
+
+/**
+* \brief Returns the size of the sdft_Pipeline struct which has to be allocated by the user of the library.
+*/
+size_t sdft_size_of_pipeline();
+
+/**
+* \brief Parses a textual description of the stages of a pipeline.
+*
+* The description lists the stages separated by '|', each given by the name and parameters noted in sdft_StageKind,
+* e.g. "gain 0.5 | dc 0.995 | sdft 128 | power | bands 0 8 32 64 | sink 0".
+*
+* \param config the zero terminated description.
+* \param stages a buffer receiving the stages. At least max_stages elements.
+* \param max_stages the number of elements of stages.
+* \param n_stages receives the number of parsed stages.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_INVALID_PIPELINE: config was malformed or described more than max_stages stages.
+*/
+enum sdft_Error sdft_parse_pipeline(
+        const char *config,
+        struct sdft_Stage *stages,
+        size_t max_stages,
+        size_t *n_stages);
+
+/**
+* \brief Returns the size in bytes of the buffer which has to be passed to sdft_init_pipeline.
+*/
+size_t sdft_pipeline_buffer_size(struct sdft_State *state, const struct sdft_Stage *stages, size_t n_stages);
+
+/**
+* \brief Initializes a pipeline which feeds the frames passed to sdft_pipeline_process through the stages into state.
+*
+* The pipeline only keeps pointers to state, stages, sinks and sink_data, which thus have to outlive it. No stage
+* copies the spectrum, the output of the transform stage is the buffer returned by sdft_get_spectrum.
+*
+* \param pipeline the allocated pipeline which is initialized by this function.
+* \param state an initialized state taking single complex samples (i.e. not paired).
+* \param format the format of the samples in the frames.
+* \param n_channels the number of interleaved samples per frame.
+* \param channel the index of the sample in each frame which is fed into the pipeline.
+* \param stages the stages of the pipeline, e.g. parsed by sdft_parse_pipeline.
+* \param n_stages the number of elements of stages.
+* \param sinks the sink functions referred to by the sink stages.
+* \param sink_data the user_data passed to each of the sinks.
+* \param n_sinks the number of elements of sinks and sink_data.
+* \param buffer a buffer for the outputs and internal state of the stages. At least
+*        sdft_pipeline_buffer_size(state, stages, n_stages) bytes, suitably aligned for doubles.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_INVALID_PIPELINE: the stages were not ordered as described in sdft_StageKind, a band exceeded the
+*                                 spectrum, a sink did not exist, a gain was not finite, the pole of a DC removal
+*                                 was not inside (-1, 1), or channel was not smaller than n_channels.
+*          SDFT_INVALID_HOP_SIZE: the parameter of the transform stage was < 1 or not finite.
+*          SDFT_NOT_SUPPORTED: state takes samples larger than one complex number, e.g. it is paired, or rejects real
+*                              samples, e.g. it was initialized with SDFT_IMAG_ONLY.
+*/
+enum sdft_Error sdft_init_pipeline(
+        struct sdft_Pipeline *pipeline,
+        struct sdft_State *state,
+        enum sdft_SampleFormat format,
+        size_t n_channels,
+        size_t channel,
+        const struct sdft_Stage *stages,
+        size_t n_stages,
+        const sdft_Sink *sinks,
+        void *const *sink_data,
+        size_t n_sinks,
+        void *buffer);
+
+/**
+* \brief Runs a block of frames through the pipeline in a single loop.
+*
+* The frames need not be aligned to the size of a sample, e.g. they may directly follow a 44 byte WAV header.
+*
+* \returns an error code indicating success or failure, e.g. the error of sdft_push_next_sample.
+*
+* Runtime: O(n_frames * window_size)
+*/
+enum sdft_Error sdft_pipeline_process(struct sdft_Pipeline *pipeline, const void *frames, size_t n_frames);
+
+#ifdef __cplusplus
+};
+#endif
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "sdft/sdft.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+* \brief An opaque struct describing a mapping of a pool of states in shared memory.
+*
+* A pool holds n_states sdft_FlatState blocks of the same configuration in a single shared memory object, each guarded
+* by a sequence lock. One writer process pushes samples into the states, any number of reader processes map the pool
+* read-only and read the spectra without copying them through pipes or sockets. The pool is only available on POSIX
+* systems.
+*/
+struct sdft_Pool;
+
+/**
+* \brief Returns the size of the sdft_Pool struct which has to be allocated by the user of the library.
+*/
+size_t sdft_size_of_pool();
+
+/**
+* \brief Creates a shared memory object holding n_states zero'ed states and maps it for writing.
+*
+* \param pool the allocated pool which is initialized by this function.
+* \param name the name of the POSIX shared memory object (see shm_open), e.g. "/spectra", which must not exist yet.
+*        Pass NULL to create an anonymous object (memfd_create, Linux only), which can be shared through
+*        sdft_pool_get_fd, e.g. by passing the descriptor over a Unix socket.
+* \param n_states the number of states of the pool.
+* \param precision, window_size, signal_traits, kind the configuration of all states, see sdft_init_flat.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_WINDOW_TOO_SHORT: The window_size was too small (e.g. < 1).
+*          SDFT_SYSTEM_ERROR: creating or mapping the shared memory failed, errno holds the reason, e.g. EOVERFLOW
+*                             if the states do not fit into a shared memory object. An object created under name
+*                             is removed again.
+*          SDFT_NOT_SUPPORTED: name was NULL, but anonymous shared memory is not available, or window_size was too
+*                              large, see sdft_init_flat.
+*
+* Runtime: O(n_states * window_size)
+*/
+enum sdft_Error sdft_pool_create(
+        struct sdft_Pool *pool,
+        const char *name,
+        size_t n_states,
+        enum sdft_FloatPrecision precision,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        enum sdft_FlatKind kind);
+
+/**
+* \brief Maps the pool in the shared memory object name read-only.
+*
+* \returns an error code indicating success or failure.
+*          SDFT_SYSTEM_ERROR: opening or mapping the shared memory failed, errno holds the reason.
+*          SDFT_INVALID_FLAT_STATE: the shared memory object does not hold a pool.
+*/
+enum sdft_Error sdft_pool_open(struct sdft_Pool *pool, const char *name);
+
+/**
+* \brief Maps the pool in the shared memory object referred to by fd read-only, e.g. one received from the writer.
+*        The descriptor is duplicated, so the caller may close fd afterwards.
+*
+* \returns the same errors as sdft_pool_open.
+*/
+enum sdft_Error sdft_pool_open_fd(struct sdft_Pool *pool, int fd);
+
+/**
+* \brief Unmaps the pool. The shared memory object itself persists until it is unlinked (see shm_unlink) and no
+*        process maps it anymore.
+*/
+void sdft_pool_close(struct sdft_Pool *pool);
+
+/**
+* \brief Returns the file descriptor of the shared memory object of the pool.
+*
+* The descriptor of an anonymous pool may be passed to untrusted readers: the object is sealed against resizing and,
+* on Linux 5.1 and later, against writable mappings (see F_SEAL_FUTURE_WRITE), so only the mapping of the writer can
+* modify the states.
+*/
+int sdft_pool_get_fd(const struct sdft_Pool *pool);
+
+/**
+* \brief Returns the number of states of the pool.
+*/
+size_t sdft_pool_get_number_of_states(const struct sdft_Pool *pool);
+
+/**
+* \brief Returns the flat state with the given index, or NULL if index is out of range.
+*
+* The writer creates handles for pushing with sdft_init_from_flat. Readers must only access it, e.g. through
+* sdft_flat_get_spectrum, between sdft_pool_begin_read and sdft_pool_end_read.
+*/
+struct sdft_FlatState *sdft_pool_get_state(const struct sdft_Pool *pool, size_t index);
+
+/**
+* \brief Marks the state with the given index as being written by the writer.
+*
+* All pushes into the state have to happen between sdft_pool_begin_write and sdft_pool_end_write. Pushing a whole block
+* of samples in between keeps the overhead of the lock small, and readers see the spectrum after each block.
+*/
+void sdft_pool_begin_write(struct sdft_Pool *pool, size_t index);
+
+/**
+* \brief Publishes the writes since the matching sdft_pool_begin_write to readers.
+*/
+void sdft_pool_end_write(struct sdft_Pool *pool, size_t index);
+
+/**
+* \brief Starts reading the state with the given index and returns the token to pass to sdft_pool_end_read. Spins while
+*        the writer is writing the state.
+*/
+unsigned long long sdft_pool_begin_read(const struct sdft_Pool *pool, size_t index);
+
+/**
+* \brief Returns whether everything read since the sdft_pool_begin_read which returned token is consistent, i.e. whether
+*        the writer did not write the state in the meantime. If not, the read has to be retried.
+*/
+int sdft_pool_end_read(const struct sdft_Pool *pool, size_t index, unsigned long long token);
+
+/**
+* \brief Copies a consistent snapshot of the spectrum of the state with the given index to spectrum, retrying while
+*        the writer interferes.
+*
+* \param spectrum receives sdft_get_number_of_bins complex elements of the precision of the state.
+*
+* \returns the number of bins copied, 0 if the header of the state does not fit into its slot of the pool.
+*/
+size_t sdft_pool_read_spectrum(const struct sdft_Pool *pool, size_t index, void *spectrum);
+
+#ifdef __cplusplus
+};
+#endif
@@ -1,7 +1,19 @@
 #include <cassert>
+#include <cstring>
 
+#include <cmath>
 #include <complex>
 #include <algorithm>
+#include <chrono>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SDFT_HAVE_RDTSC
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SDFT_HAVE_RDTSC
+#endif
 
 #include "sdft/sdft.h"
 
@@ -10,198 +22,3021 @@
 //
 
 struct sdft_State {
+    sdft_State()
+            : _latency_histogram(0), _latency_interval(0), _latency_counter(0)
+    {
+    }
+
     virtual enum sdft_Error validate() = 0;
 
     virtual enum sdft_Error push_next_sample(void *next_sample) = 0;
 
+    // Pushes fill (or zeros if NULL) n_samples times, see sdft_skip_samples. Kinds of states with a closed form
+    // override it.
+    virtual enum sdft_Error skip_samples(size_t n_samples, const void *fill)
+    {
+        // large enough for the samples of all kinds of states, e.g. the two complex numbers of paired states
+        const long double zeros[4] = {0, 0, 0, 0};
+        void *sample = const_cast<void *>(fill != 0 ? fill : zeros);
+        for (size_t i = 0; i < n_samples; ++i) {
+            enum sdft_Error err = push_next_sample(sample);
+            if (err != SDFT_NO_ERROR) {
+                return err;
+            }
+        }
+
+        return SDFT_NO_ERROR;
+    }
+
+    // Pushes the n_samples samples at samples, of which only the state after the last one matters, see sdft_catch_up.
+    // Kinds of states which can recompute the spectrum from the window override it.
+    virtual enum sdft_Error catch_up(const void *samples, size_t n_samples)
+    {
+        enum sdft_Error err = check_samples(samples, n_samples);
+        if (err != SDFT_NO_ERROR) {
+            return err;
+        }
+
+        const size_t sample_size = get_sample_size();
+        for (size_t i = 0; i < n_samples; ++i) {
+            enum sdft_Error err = push_next_sample(const_cast<char *>((const char *) samples) + i * sample_size);
+            if (err != SDFT_NO_ERROR) {
+                return err;
+            }
+        }
+
+        return SDFT_NO_ERROR;
+    }
+
+    // Returns whether pushing the n_samples samples at samples would violate the signal traits of the state, without
+    // pushing them. Kinds of states with signal traits override it.
+    virtual enum sdft_Error check_samples(const void *, size_t) const
+    {
+        return SDFT_NO_ERROR;
+    }
+
+    // Returns the size of a sample of push_next_sample in bytes.
+    virtual size_t get_sample_size() const = 0;
+
     virtual void *get_spectrum() = 0;
 
-    virtual void *unshift_and_get_window() = 0;
+    virtual void *unshift_and_get_window() = 0;
+
+    virtual enum sdft_Error combine_with(struct sdft_State *other, void *buffer) = 0;
+
+    virtual enum sdft_Error pair_with(struct sdft_State *, void *, void *, void *, double)
+    {
+        return SDFT_NOT_COMBINABLE;
+    }
+
+    virtual void *get_cross_spectrum()
+    {
+        return 0;
+    }
+
+    virtual void *get_auto_spectrum(size_t)
+    {
+        return 0;
+    }
+
+    virtual enum sdft_Error get_coherence(void *)
+    {
+        return SDFT_NOT_SUPPORTED;
+    }
+
+    virtual enum sdft_Error enable_averaging(void *, double, size_t)
+    {
+        return SDFT_NOT_SUPPORTED;
+    }
+
+    virtual enum sdft_Error enable_lazy_rotation(bool)
+    {
+        return SDFT_NOT_SUPPORTED;
+    }
+
+    virtual void *get_averaged_power()
+    {
+        return 0;
+    }
+
+    virtual enum sdft_Error resize(size_t, void *, void *, void *)
+    {
+        return SDFT_NOT_SUPPORTED;
+    }
+
+    virtual double get_bin_frequency(size_t bin) = 0;
+
+    virtual size_t get_number_of_bins() const = 0;
+
+    virtual enum sdft_FloatPrecision get_precision() const = 0;
+
+    virtual ~sdft_State()
+    {
+    };
+
+    // see sdft_enable_latency_histogram, recorded by sdft_push_next_sample for all kinds of states
+    struct sdft_LatencyHistogram *_latency_histogram;
+    size_t _latency_interval;
+    size_t _latency_counter;
+};
+
+//
+// Helpers shared by the different kinds of states.
+//
+
+// Reads the counter of the push latencies, see sdft_get_latency_tick_rate.
+static inline unsigned long long read_latency_ticks()
+{
+#ifdef SDFT_HAVE_RDTSC
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// Returns the bucket of a sdft_LatencyHistogram counting ticks.
+static size_t latency_bucket(unsigned long long ticks)
+{
+    if (ticks < 16) {
+        return static_cast<size_t>(ticks);
+    }
+
+    // the position of the highest set bit, at least 4
+    size_t e = 4;
+    while (ticks >> (e + 1)) {
+        ++e;
+    }
+    return (e - 3) * 16 + ((ticks >> (e - 4)) & 15);
+}
+
+// Returns the largest value which falls into bucket.
+static unsigned long long latency_bucket_upper_bound(size_t bucket)
+{
+    if (bucket < 16) {
+        return bucket;
+    }
+
+    size_t e = bucket / 16 + 3;
+    unsigned long long width = 1ull << (e - 4);
+    return (16 + bucket % 16) * width + (width - 1);
+}
+
+// Writes the phase offsets e^{2 pi i k / window_size} of the bins k of the DFT to phase_offsets.
+template<typename Float>
+static void generate_dft_phase_offsets(std::complex<Float> *phase_offsets, size_t window_size)
+{
+    const Float double_pi = static_cast<Float>(2 * 3.141592653589793238462643383279502884); // Enough precision for everyone!
+    for (size_t i = 0; i < window_size; i++) {
+        std::complex<Float> angle(0, double_pi * i / window_size);
+        phase_offsets[i] = std::exp(angle);
+    };
+}
+
+// Converts a time constant (in updates) to the weight of the newest value in an exponential average.
+template<typename Float>
+static Float alpha_from_time_constant(double time_constant)
+{
+    return time_constant > 0 ? static_cast<Float>(1 - std::exp(-1 / time_constant)) : 1;
+}
+
+// An optional exponentially averaged power spectrum, updated every _hop_size pushes.
+template<typename Float>
+struct Averaging {
+    Averaging()
+            : _power(0), _alpha(1), _hop_size(1), _hop_counter(0)
+    {
+    }
+
+    void enable(void *power, const std::complex<Float> *spectrum, size_t n_bins, double time_constant,
+            size_t hop_size)
+    {
+        _power = (Float *) power;
+        _alpha = alpha_from_time_constant<Float>(time_constant);
+        _hop_size = hop_size;
+        _hop_counter = 0;
+        for (size_t i = 0; _power != 0 && i < n_bins; ++i) {
+            _power[i] = std::norm(spectrum[i]);
+        }
+    }
+
+    // Advances the hop counter and returns whether the average has to be updated in this push.
+    bool next_push_is_hop()
+    {
+        if (_power == 0 || ++_hop_counter != _hop_size) {
+            return false;
+        }
+
+        _hop_counter = 0;
+        return true;
+    }
+
+    void update(size_t i, const std::complex<Float> &X)
+    {
+        _power[i] += _alpha * (std::norm(X) - _power[i]);
+    }
+
+    // Advances the hop counter by n_pushes pushes whose spectra are not available, and applies all updates due in the
+    // meantime with the spectrum after them.
+    void skip(size_t n_pushes, const std::complex<Float> *spectrum, size_t n_bins)
+    {
+        if (_power == 0) {
+            return;
+        }
+
+        const size_t n_hops = (_hop_counter + n_pushes) / _hop_size;
+        _hop_counter = (_hop_counter + n_pushes) % _hop_size;
+        if (n_hops == 0) {
+            return;
+        }
+
+        const Float weight = 1 - std::pow(1 - _alpha, static_cast<Float>(n_hops));
+        for (size_t i = 0; i < n_bins; ++i) {
+            _power[i] += weight * (std::norm(spectrum[i]) - _power[i]);
+        }
+    }
+
+    Float *_power;
+    Float _alpha;
+    size_t _hop_size;
+    size_t _hop_counter;
+};
+
+// Returns exp(2 * pi * i * cycles), computing the angle in the highest available precision.
+template<typename Float>
+static std::complex<Float> unit_phasor(long double cycles)
+{
+    const long double double_pi = 2 * 3.141592653589793238462643383279502884L;
+    const long double angle = double_pi * (cycles - std::floor(cycles));
+    return std::complex<Float>(static_cast<Float>(std::cos(angle)), static_cast<Float>(std::sin(angle)));
+}
+
+template<typename Float>
+static bool matches_signal_trait(enum sdft_SignalTraits signal_traits, const std::complex<Float> &c)
+{
+    return signal_traits == SDFT_REAL_AND_IMAG
+            || (signal_traits == SDFT_REAL_ONLY && std::imag(c) == 0)
+            || (signal_traits == SDFT_IMAG_ONLY && std::real(c) == 0);
+}
+
+template<typename Float>
+static sdft_Error check_signal_traits(enum sdft_SignalTraits signal_traits, const std::complex<Float> *samples,
+        size_t n_samples)
+{
+    for (size_t i = 0; i < n_samples; ++i) {
+        if (!matches_signal_trait(signal_traits, samples[i])) {
+            return SDFT_SIGNAL_TRAIT_VIOLATION;
+        }
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+// Slides the bins of the DFT by the difference delta of the incoming and the outgoing sample and updates the average
+// while each bin is still in a register.
+template<typename Float>
+static void slide_dft_bins(std::complex<Float> *spectrum, const std::complex<Float> *phase_offsets, size_t n_bins,
+        const std::complex<Float> &delta, Averaging<Float> &averaging)
+{
+    if (averaging.next_push_is_hop()) {
+        Float *power = averaging._power;
+        const Float alpha = averaging._alpha;
+        for (size_t i = 0; i < n_bins; ++i) {
+            const std::complex<Float> X = (spectrum[i] + delta) * phase_offsets[i];
+            spectrum[i] = X;
+            power[i] += alpha * (std::norm(X) - power[i]);
+        }
+    } else {
+        for (size_t i = 0; i < n_bins; ++i) {
+            spectrum[i] = (spectrum[i] + delta) * phase_offsets[i];
+        }
+    }
+}
+
+// Stores ns in the window ring at window_index, advances it and returns the difference to the sample it replaced.
+template<typename Float>
+static std::complex<Float> advance_ring(std::complex<Float> *window, size_t window_size, size_t &window_index,
+        const std::complex<Float> &ns)
+{
+    const std::complex<Float> delta = ns - window[window_index];
+
+    window[window_index] = ns;
+    if (++window_index == window_size) {
+        window_index = 0;
+    }
+
+    return delta;
+}
+
+// Pushes ns into a combined state on the bins of the DFT whose two spectra share one window ring and one table of
+// phase offsets, see SharedCombined. Returns the index of the valid spectrum after the push.
+template<typename Float>
+static size_t push_shared_combined(std::complex<Float> *window,
+        std::complex<Float> *const *spectra, const std::complex<Float> *phase_offsets, size_t window_size,
+        size_t n_bins, size_t &window_index, size_t &clear_counter, const std::complex<Float> &ns,
+        Averaging<Float> &averaging)
+{
+    typedef std::complex<Float> cplx;
+    assert(clear_counter <= 2 * window_size);
+
+    // the same schedule as Combined::push_next_sample
+    if (clear_counter == window_size) {
+        std::fill(spectra[0], spectra[0] + n_bins, std::complex<Float>(0));
+    } else if (clear_counter == 2 * window_size) {
+        std::fill(spectra[1], spectra[1] + n_bins, std::complex<Float>(0));
+        clear_counter = 0;
+    }
+
+    // the spectrum cleared last has zeros in place of the samples of its window which were pushed before the clear
+    const cplx full_delta = advance_ring(window, window_size, window_index, ns);
+    const cplx delta_0 = clear_counter < window_size ? full_delta : ns;
+    const cplx delta_1 = clear_counter < window_size ? ns : full_delta;
+    clear_counter++;
+    const size_t valid = clear_counter <= window_size ? 0 : 1;
+
+    cplx *spectrum_0 = spectra[0];
+    cplx *spectrum_1 = spectra[1];
+    if (averaging.next_push_is_hop()) {
+        Float *power = averaging._power;
+        const Float alpha = averaging._alpha;
+        for (size_t i = 0; i < n_bins; ++i) {
+            const cplx w = phase_offsets[i];
+            const cplx X_0 = (spectrum_0[i] + delta_0) * w;
+            const cplx X_1 = (spectrum_1[i] + delta_1) * w;
+            spectrum_0[i] = X_0;
+            spectrum_1[i] = X_1;
+            power[i] += alpha * (std::norm(valid == 0 ? X_0 : X_1) - power[i]);
+        }
+    } else {
+        for (size_t i = 0; i < n_bins; ++i) {
+            const cplx w = phase_offsets[i];
+            spectrum_0[i] = (spectrum_0[i] + delta_0) * w;
+            spectrum_1[i] = (spectrum_1[i] + delta_1) * w;
+        }
+    }
+
+    return valid;
+}
+
+static bool is_power_of_two(size_t n)
+{
+    return n != 0 && (n & (n - 1)) == 0;
+}
+
+// Transforms data of length n in place into its DFT. n has to be a power of two which divides window_size, so that the
+// twiddles e^{-2 pi i j / n} are exact entries of the table of phase offsets of the bins of the DFT of window_size.
+template<typename Float>
+static void fft_in_place(std::complex<Float> *data, size_t n, const std::complex<Float> *phase_offsets,
+        size_t window_size)
+{
+    for (size_t i = 1, j = 0; i < n; ++i) {
+        size_t bit = n >> 1;
+        for (; j & bit; bit >>= 1) {
+            j ^= bit;
+        }
+        j ^= bit;
+        if (i < j) {
+            std::swap(data[i], data[j]);
+        }
+    }
+
+    for (size_t length = 2; length <= n; length <<= 1) {
+        const size_t half = length / 2;
+        const size_t stride = window_size / length;
+        for (size_t start = 0; start < n; start += length) {
+            for (size_t j = 0; j < half; ++j) {
+                const std::complex<Float> t = data[start + half + j] * std::conj(phase_offsets[j * stride]);
+                data[start + half + j] = data[start + j] - t;
+                data[start + j] += t;
+            }
+        }
+    }
+}
+
+// Computes the bins of the DFT of a window ring, whose oldest sample is at window_index and whose size is a power of
+// two, into spectrum, which only holds the first half of the bins unless signal_traits is SDFT_REAL_AND_IMAG.
+template<typename Float>
+static void fft_of_window(std::complex<Float> *spectrum, const std::complex<Float> *window, size_t window_index,
+        const std::complex<Float> *phase_offsets, size_t window_size, enum sdft_SignalTraits signal_traits)
+{
+    typedef std::complex<Float> cplx;
+    const size_t N = window_size;
+
+    if (signal_traits == SDFT_REAL_AND_IMAG) {
+        std::copy(window + window_index, window + N, spectrum);
+        std::copy(window, window + window_index, spectrum + (N - window_index));
+        fft_in_place(spectrum, N, phase_offsets, N);
+        return;
+    }
+
+    // The N real (or imaginary) samples as N / 2 complex ones z_j = x_{2j} + i x_{2j+1}, whose DFT Z yields
+    // X_k = E_k + W^{-k} O_k with the DFTs E_k = (Z_k + conj(Z_{M-k})) / 2 and O_k = -i (Z_k - conj(Z_{M-k})) / 2 of
+    // the even and odd samples.
+    const size_t M = N / 2;
+    const bool imag = signal_traits == SDFT_IMAG_ONLY;
+    for (size_t j = 0; j < M; ++j) {
+        const cplx &a = window[(window_index + 2 * j) % N];
+        const cplx &b = window[(window_index + 2 * j + 1) % N];
+        spectrum[j] = imag ? cplx(a.imag(), b.imag()) : cplx(a.real(), b.real());
+    }
+    fft_in_place(spectrum, M, phase_offsets, N);
+
+    const cplx minus_i(0, -1);
+    for (size_t k = 0; k <= M / 2 && M > 0; ++k) {
+        const size_t l = (M - k) % M;
+        const cplx z_k = spectrum[k];
+        const cplx z_l = spectrum[l];
+        cplx X_k = (z_k + std::conj(z_l) + std::conj(phase_offsets[k]) * minus_i * (z_k - std::conj(z_l))) / Float(2);
+        cplx X_l = (z_l + std::conj(z_k) + std::conj(phase_offsets[l]) * minus_i * (z_l - std::conj(z_k))) / Float(2);
+        if (imag) {
+            // the transform is linear, so that of i * y is i times that of y
+            X_k *= cplx(0, 1);
+            X_l *= cplx(0, 1);
+        }
+        spectrum[k] = X_k;
+        spectrum[l] = X_l;
+    }
+}
+
+// Computes the bins of the DFT of a window ring like fft_of_window, for window sizes which are no powers of two directly
+// with the exact twiddles of the table of phase offsets.
+template<typename Float>
+static void dft_of_window(std::complex<Float> *spectrum, const std::complex<Float> *window, size_t window_index,
+        const std::complex<Float> *phase_offsets, size_t window_size, enum sdft_SignalTraits signal_traits)
+{
+    const size_t N = window_size;
+    if (is_power_of_two(N)) {
+        fft_of_window(spectrum, window, window_index, phase_offsets, N, signal_traits);
+        return;
+    }
+
+    const size_t n_bins = signal_traits == SDFT_REAL_AND_IMAG ? N : N / 2;
+    for (size_t k = 0; k < n_bins; ++k) {
+        std::complex<Float> sum(0);
+        size_t offset = 0;
+        size_t position = window_index;
+        for (size_t j = 0; j < N; ++j) {
+            sum += window[position] * std::conj(phase_offsets[offset]);
+            offset += k;
+            if (offset >= N) {
+                offset -= N;
+            }
+            if (++position == N) {
+                position = 0;
+            }
+        }
+        spectrum[k] = sum;
+    }
+}
+
+// Returns the frequency of a phasor exp(2 * pi * i * f) as f in cycles per sample, in [0, 1).
+template<typename Float>
+static double frequency_of_phasor(const std::complex<Float> &phasor)
+{
+    const double double_pi = 2 * 3.141592653589793238462643383279502884;
+    const double cycles = static_cast<double>(std::arg(phasor)) / double_pi;
+    return cycles < 0 ? cycles + 1 : cycles;
+}
+
+template<typename Float>
+struct Precision;
+
+template<>
+struct Precision<float> {
+    static const sdft_FloatPrecision value = SDFT_SINGLE;
+};
+
+template<>
+struct Precision<double> {
+    static const sdft_FloatPrecision value = SDFT_DOUBLE;
+};
+
+template<>
+struct Precision<long double> {
+    static const sdft_FloatPrecision value = SDFT_LONG_DOUBLE;
+};
+
+// The common base of all states operating on the floating point type Float.
+template<typename Float>
+struct TypedState : public sdft_State {
+    typedef Float float_type;
+
+    enum sdft_FloatPrecision get_precision() const
+    {
+        return Precision<Float>::value;
+    }
+
+    size_t get_sample_size() const
+    {
+        return sizeof(std::complex<Float>);
+    }
+};
+
+template<typename State>
+struct Combined;
+
+template<typename Float>
+struct Paired;
+
+template<typename Float>
+struct Impl : public TypedState<Float> {
+    Impl(void *signal, void *spectrum, void *phase_offsets, size_t window_size,
+            enum sdft_SignalTraits signal_traits);
+
+    Impl(void *signal, void *spectrum, void *phase_offsets, size_t window_size,
+            enum sdft_SignalTraits signal_traits, const double *bins, size_t n_bins);
+
+    sdft_Error validate();
+
+    void clear();
+
+    size_t get_window_size() const
+    {
+        return _window_size;
+    }
+
+    sdft_Error push_next_sample(void *next_sample);
+
+    sdft_Error skip_samples(size_t n_samples, const void *fill);
+
+    sdft_Error catch_up(const void *samples, size_t n_samples);
+
+    sdft_Error check_samples(const void *samples, size_t n_samples) const
+    {
+        return check_signal_traits(_signal_traits, (const std::complex<Float> *) samples, n_samples);
+    }
+
+    sdft_Error resize(size_t window_size, void *window, void *spectrum, void *phase_offsets);
+
+    void *get_spectrum()
+    {
+        apply_pending_rotation();
+        return _spectrum;
+    }
+
+    void *unshift_and_get_window();
+
+    sdft_Error combine_with(struct sdft_State *other, void *buffer)
+    {
+        Impl<Float> *o = dynamic_cast<Impl<Float> *>(other);
+        if (o != 0 && is_combinable_with(*o)) {
+            new(buffer) Combined<Impl<Float> >(this, o);
+            return SDFT_NO_ERROR;
+        }
+
+        return SDFT_NOT_COMBINABLE;
+    }
+
+    sdft_Error pair_with(struct sdft_State *other, void *buffer, void *cross_spectrum, void *auto_spectra,
+            double time_constant)
+    {
+        Impl<Float> *o = dynamic_cast<Impl<Float> *>(other);
+        if (o != 0 && is_combinable_with(*o)) {
+            new(buffer) Paired<Float>(this, o, cross_spectrum, auto_spectra, time_constant);
+            return SDFT_NO_ERROR;
+        }
+
+        return SDFT_NOT_COMBINABLE;
+    }
+
+    sdft_Error enable_averaging(void *averaged_power, double time_constant, size_t hop_size)
+    {
+        _averaging.enable(averaged_power, _spectrum, get_number_of_bins(), time_constant, hop_size);
+        return SDFT_NO_ERROR;
+    }
+
+    sdft_Error enable_lazy_rotation(bool enable)
+    {
+        // Pushes to arbitrary bins weigh the incoming sample with _corrections, so they never reduce to a rotation.
+        if (_corrections != 0) {
+            return SDFT_NOT_SUPPORTED;
+        }
+
+        if (!enable) {
+            apply_pending_rotation();
+        }
+        _lazy_rotation = enable;
+        return SDFT_NO_ERROR;
+    }
+
+    void *get_averaged_power()
+    {
+        return _averaging._power;
+    }
+
+    double get_bin_frequency(size_t bin)
+    {
+        if (bin >= get_number_of_bins()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return _corrections != 0
+                ? frequency_of_phasor(_phase_offsets[bin])
+                : static_cast<double>(bin) / _window_size;
+    }
+
+    size_t get_number_of_bins() const
+    {
+        if (_corrections != 0) {
+            return _n_bins;
+        }
+
+        return _signal_traits == SDFT_REAL_AND_IMAG
+                ? _window_size
+                : _window_size / 2; // only first half of spectrum relevant
+    }
+
+private:
+    friend struct Paired<Float>;
+
+    typedef std::complex<Float> cplx;
+
+    bool matches_signal_trait(const cplx &c) const;
+
+    bool is_combinable_with(const Impl<Float> &other) const
+    {
+        return other._window_size == _window_size
+                && other._signal_traits == _signal_traits
+                && (other._corrections == 0) == (_corrections == 0)
+                && other.get_number_of_bins() == get_number_of_bins()
+                && (_corrections == 0
+                        || (std::equal(_phase_offsets, _phase_offsets + _n_bins, other._phase_offsets)
+                                && std::equal(_corrections, _corrections + _n_bins, other._corrections)));
+    }
+
+    // Stores ns in the window and returns the difference to the sample it replaced.
+    cplx advance_window(const cplx &ns);
+
+    // push_next_sample for arbitrary bins
+    sdft_Error push_next_sample_to_bins(const cplx &ns);
+
+    // Rotates the spectrum by the pushes which were only counted in _pending_rotation.
+    void apply_pending_rotation();
+
+    cplx *_window;
+    cplx *_spectrum;
+    cplx *_phase_offsets;
+    // The weights of the incoming sample for non-integral bins, NULL for the bins of the DFT.
+    cplx *_corrections;
+    size_t _window_index;
+    // The number of pushes (modulo _window_size) with a zero delta, which only rotate the spectrum and have not been
+    // applied to _spectrum yet, see push_next_sample. Only counted with _lazy_rotation.
+    size_t _pending_rotation;
+    size_t _window_size;
+    size_t _n_bins;
+    bool _finite;
+    bool _lazy_rotation;
+    enum sdft_SignalTraits _signal_traits;
+    Averaging<Float> _averaging;
+};
+
+// Combines two states of the same kind State, which have to provide clear(), get_window_size() and
+// get_number_of_bins() in addition to the sdft_State interface.
+template<typename State>
+struct Combined : public TypedState<typename State::float_type> {
+    typedef typename State::float_type Float;
+
+    Combined(State *first, State *second);
+
+    sdft_Error validate();
+
+    sdft_Error push_next_sample(void *next_sample);
+
+    sdft_Error skip_samples(size_t n_samples, const void *fill);
+
+    sdft_Error catch_up(const void *samples, size_t n_samples);
+
+    sdft_Error resize(size_t window_size, void *window, void *spectrum, void *phase_offsets);
+
+    size_t get_sample_size() const
+    {
+        return _first->get_sample_size();
+    }
+
+    sdft_Error check_samples(const void *samples, size_t n_samples) const
+    {
+        return _first->check_samples(samples, n_samples);
+    }
+
+    void *unshift_and_get_window();
+
+    void *get_spectrum()
+    {
+        assert(_clear_counter <= 2 * _window_size);
+        // See the invariant in push_next_sample.
+        return _clear_counter <= _window_size
+                ? _first->get_spectrum()
+                : _second->get_spectrum();
+    }
+
+    enum sdft_Error combine_with(struct sdft_State *, void *)
+    {
+        return SDFT_NOT_COMBINABLE;
+    }
+
+    sdft_Error enable_averaging(void *averaged_power, double time_constant, size_t hop_size)
+    {
+        _averaging.enable(averaged_power, (std::complex<Float> *) get_spectrum(), _first->get_number_of_bins(),
+                time_constant, hop_size);
+        return SDFT_NO_ERROR;
+    }
+
+    sdft_Error enable_lazy_rotation(bool enable)
+    {
+        sdft_Error error = _first->enable_lazy_rotation(enable);
+        return error == SDFT_NO_ERROR ? _second->enable_lazy_rotation(enable) : error;
+    }
+
+    void *get_averaged_power()
+    {
+        return _averaging._power;
+    }
+
+    double get_bin_frequency(size_t bin)
+    {
+        return _first->get_bin_frequency(bin);
+    }
+
+    size_t get_number_of_bins() const
+    {
+        return _first->get_number_of_bins();
+    }
+
+private:
+    State *_first;
+    State *_second;
+    size_t _window_size;
+    size_t _clear_counter;
+    Averaging<Float> _averaging;
+};
+
+// A combined plain state on the bins of the DFT, whose two spectra share a single window ring and twiddle table.
+//
+// It behaves exactly like Combined<Impl<Float> >: Right after a sub-state of Combined has been cleared, its window
+// holds zeros which the following window_size pushes replace, so the outgoing sample of that spectrum is zero while
+// that of the other spectrum is taken from the (shared) window. Both spectra are updated in one loop.
+template<typename Float>
+struct SharedCombined : public TypedState<Float> {
+    SharedCombined(void *window, void *spectra, void *phase_offsets, size_t window_size,
+            enum sdft_SignalTraits signal_traits);
+
+    sdft_Error validate();
+
+    sdft_Error push_next_sample(void *next_sample);
+
+    sdft_Error check_samples(const void *samples, size_t n_samples) const
+    {
+        return check_signal_traits(_signal_traits, (const std::complex<Float> *) samples, n_samples);
+    }
+
+    void *unshift_and_get_window();
+
+    void *get_spectrum()
+    {
+        assert(_clear_counter <= 2 * _window_size);
+        // See the invariant in Combined::push_next_sample.
+        return _clear_counter <= _window_size ? _spectra[0] : _spectra[1];
+    }
+
+    enum sdft_Error combine_with(struct sdft_State *, void *)
+    {
+        return SDFT_NOT_COMBINABLE;
+    }
+
+    sdft_Error enable_averaging(void *averaged_power, double time_constant, size_t hop_size)
+    {
+        _averaging.enable(averaged_power, (std::complex<Float> *) get_spectrum(), get_number_of_bins(),
+                time_constant, hop_size);
+        return SDFT_NO_ERROR;
+    }
+
+    void *get_averaged_power()
+    {
+        return _averaging._power;
+    }
+
+    double get_bin_frequency(size_t bin)
+    {
+        if (bin >= get_number_of_bins()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return static_cast<double>(bin) / _window_size;
+    }
+
+    size_t get_number_of_bins() const
+    {
+        return _signal_traits == SDFT_REAL_AND_IMAG
+                ? _window_size
+                : _window_size / 2; // only first half of spectrum relevant
+    }
+
+private:
+    typedef std::complex<Float> cplx;
+
+    cplx *_window;
+    cplx *_spectra[2];
+    cplx *_phase_offsets;
+    size_t _window_index;
+    size_t _window_size;
+    enum sdft_SignalTraits _signal_traits;
+    size_t _clear_counter;
+    Averaging<Float> _averaging;
+};
+
+// A handle to a position-independent sdft_FlatState, which resolves the offsets of the block on each access.
+template<typename Float>
+struct FlatView : public TypedState<Float> {
+    explicit FlatView(struct sdft_FlatState *flat)
+            : _flat(flat)
+    {
+    }
+
+    sdft_Error validate();
+
+    sdft_Error push_next_sample(void *next_sample);
+
+    sdft_Error check_samples(const void *samples, size_t n_samples) const
+    {
+        return check_signal_traits((enum sdft_SignalTraits) _flat->signal_traits, (const std::complex<Float> *) samples, n_samples);
+    }
+
+    void *unshift_and_get_window();
+
+    void *get_spectrum()
+    {
+        return spectrum(_flat->kind == SDFT_FLAT_COMBINED && _flat->clear_counter > _flat->window_size ? 1 : 0);
+    }
+
+    enum sdft_Error combine_with(struct sdft_State *, void *)
+    {
+        return SDFT_NOT_COMBINABLE;
+    }
+
+    sdft_Error enable_averaging(void *averaged_power, double time_constant, size_t hop_size)
+    {
+        _averaging.enable(averaged_power, (std::complex<Float> *) get_spectrum(), get_number_of_bins(),
+                time_constant, hop_size);
+        return SDFT_NO_ERROR;
+    }
+
+    void *get_averaged_power()
+    {
+        return _averaging._power;
+    }
+
+    double get_bin_frequency(size_t bin)
+    {
+        if (bin >= get_number_of_bins()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return static_cast<double>(bin) / _flat->window_size;
+    }
+
+    size_t get_number_of_bins() const
+    {
+        return _flat->signal_traits == SDFT_REAL_AND_IMAG
+                ? static_cast<size_t>(_flat->window_size)
+                : static_cast<size_t>(_flat->window_size / 2); // only first half of spectrum relevant
+    }
+
+private:
+    typedef std::complex<Float> cplx;
+
+    cplx *at(uint64_t offset)
+    {
+        return (cplx *) ((char *) _flat + offset);
+    }
+
+    cplx *window()
+    {
+        return at(_flat->window_offset);
+    }
+
+    cplx *spectrum(size_t i)
+    {
+        return at(_flat->spectra_offset) + i * _flat->window_size;
+    }
+
+    cplx *phase_offsets()
+    {
+        return at(_flat->phase_offsets_offset);
+    }
+
+    struct sdft_FlatState *_flat;
+    Averaging<Float> _averaging;
+};
+
+template<typename Float>
+struct Paired : public TypedState<Float> {
+    Paired(Impl<Float> *x, Impl<Float> *y, void *cross_spectrum, void *auto_spectra, double time_constant);
+
+    sdft_Error validate();
+
+    sdft_Error push_next_sample(void *next_samples);
+
+    size_t get_sample_size() const
+    {
+        return 2 * sizeof(cplx);
+    }
+
+    void *unshift_and_get_window();
+
+    void *get_spectrum()
+    {
+        return _cross_spectrum;
+    }
+
+    enum sdft_Error combine_with(struct sdft_State *, void *)
+    {
+        return SDFT_NOT_COMBINABLE;
+    }
+
+    void *get_cross_spectrum()
+    {
+        return _cross_spectrum;
+    }
+
+    void *get_auto_spectrum(size_t channel)
+    {
+        switch (channel) {
+            case 0:
+                return _auto_spectra;
+            case 1:
+                return _auto_spectra + _x->get_number_of_bins();
+            default:
+                return 0;
+        }
+    }
+
+    sdft_Error get_coherence(void *coherence);
+
+    double get_bin_frequency(size_t bin)
+    {
+        return _x->get_bin_frequency(bin);
+    }
+
+    size_t get_number_of_bins() const
+    {
+        return _x->get_number_of_bins();
+    }
+
+private:
+    typedef std::complex<Float> cplx;
+
+    Impl<Float> *_x;
+    Impl<Float> *_y;
+    cplx *_cross_spectrum;
+    Float *_auto_spectra;
+    double _time_constant;
+    Float _alpha;
+};
+
+// A sliding cosine and sine transform of a real signal, see sdft_CosineKind.
+template<typename Float>
+struct Cosine : public TypedState<Float> {
+    Cosine(void *window, void *coefficients, void *twiddles, size_t window_size, enum sdft_CosineKind kind);
+
+    sdft_Error validate();
+
+    void clear();
+
+    size_t get_window_size() const
+    {
+        return _window_size;
+    }
+
+    size_t get_number_of_bins() const
+    {
+        return _window_size;
+    }
+
+    sdft_Error push_next_sample(void *next_sample);
+
+    size_t get_sample_size() const
+    {
+        return sizeof(Float);
+    }
+
+    void *get_spectrum()
+    {
+        return _coefficients;
+    }
+
+    double get_bin_frequency(size_t bin)
+    {
+        if (bin >= _window_size) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        // omega_k / (2 * pi)
+        return (bin + (_kind == SDFT_DCT_IV ? 0.5 : 0)) / (2.0 * _window_size);
+    }
+
+    void *unshift_and_get_window();
+
+    sdft_Error combine_with(struct sdft_State *other, void *buffer)
+    {
+        Cosine<Float> *o = dynamic_cast<Cosine<Float> *>(other);
+        if (o != 0 && o->_window_size == _window_size && o->_kind == _kind) {
+            new(buffer) Combined<Cosine<Float> >(this, o);
+            return SDFT_NO_ERROR;
+        }
+
+        return SDFT_NOT_COMBINABLE;
+    }
+
+private:
+    typedef std::complex<Float> cplx;
+
+    Float *_window;
+    cplx *_coefficients;
+    // The first _window_size twiddles rotate the coefficients by one sample, the second _window_size twiddles
+    // weight the incoming and outgoing samples, already rotated.
+    cplx *_twiddles;
+    size_t _window_index;
+    size_t _window_size;
+    enum sdft_CosineKind _kind;
+};
+
+// A bank of sliding Goertzel detectors, see sdft_init_goertzel_from_buffers.
+//
+// Detector k tracks X_k = sum_j window[j] * exp(-i * omega_k * j), which obeys
+//     X_k' = w_k * (X_k + c_k * x_new - x_old)   with w_k = exp(i * omega_k), c_k = exp(-i * omega_k * N).
+// Unrolling, X_k = w_k * y_k for the one-pole filter y_k' = u + w_k * y_k driven by u = c_k * x_new - x_old, and
+// y_k = s_k - conj(w_k) * s_k_prev for the real resonator s_k' = u + 2 * cos(omega_k) * s_k - s_k_prev.
+// For integral bins c_k is 1, so one resonator driven by x_new - x_old suffices. Otherwise, by linearity, one
+// resonator is driven by x_new and one by x_old, so that the input stays the same for all bins and the inner loop
+// does not need any complex arithmetic. Each signal component (real and/or imaginary) gets its own resonators.
+// The two resonators of a non-integral bin never cancel, so they grow without bound. Driving one resonator by
+// c_k * x_new - x_old would not help: that cancels the pole at w_k only, and the resonator still accumulates the signal
+// at its conjugate pole. Integral bins at 0 or N/2 have a double pole at 1 resp. -1, of which the zeros of
+// 1 - z^-N only cancel one. In these cases the resonators are restarted from the window every N pushes, see prime.
+template<typename Float>
+struct Goertzel : public TypedState<Float> {
+    Goertzel(void *window, void *spectrum, void *coefficients, void *resonators, size_t window_size,
+            enum sdft_SignalTraits signal_traits, const double *bins, size_t n_bins);
+
+    sdft_Error validate();
+
+    void clear();
+
+    size_t get_window_size() const
+    {
+        return _window_size;
+    }
+
+    size_t get_number_of_bins() const
+    {
+        return _n_bins;
+    }
+
+    sdft_Error push_next_sample(void *next_sample);
+
+    sdft_Error check_samples(const void *samples, size_t n_samples) const
+    {
+        return check_signal_traits(_signal_traits, (const std::complex<Float> *) samples, n_samples);
+    }
+
+    void *get_spectrum();
+
+    void *unshift_and_get_window();
+
+    double get_bin_frequency(size_t bin)
+    {
+        if (bin >= _n_bins) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return frequency_of_phasor(_phasors[bin]);
+    }
+
+    sdft_Error combine_with(struct sdft_State *other, void *buffer)
+    {
+        Goertzel<Float> *o = dynamic_cast<Goertzel<Float> *>(other);
+        if (o != 0 && o->_window_size == _window_size && o->_signal_traits == _signal_traits
+                && o->_n_bins == _n_bins && std::equal(_phasors, _phasors + 2 * _n_bins, o->_phasors)) {
+            new(buffer) Combined<Goertzel<Float> >(this, o);
+            return SDFT_NO_ERROR;
+        }
+
+        return SDFT_NOT_COMBINABLE;
+    }
+
+private:
+    typedef std::complex<Float> cplx;
+
+    size_t get_number_of_components() const
+    {
+        return _signal_traits == SDFT_REAL_AND_IMAG ? 2 : 1;
+    }
+
+    // Returns the resonator state s (previous == false) resp. s_prev (previous == true) of the given resonator and
+    // signal component (0 is the real part, 1 the imaginary part of the signal, unless only the imaginary part is
+    // tracked).
+    Float *get_resonator(size_t resonator, size_t component, bool previous) const
+    {
+        return _resonators + ((resonator * get_number_of_components() + component) * 2 + previous) * _n_bins;
+    }
+
+    // Feeds the bin-independent input into all resonators of one signal component.
+    void resonate(size_t resonator, size_t component, Float input);
+
+    // Clears the resonators and feeds the window into them, which has to start at index 0.
+    void prime();
+
+    void feed(size_t resonator, const cplx &input);
+
+    cplx *_window;
+    cplx *_spectrum;
+    // w_k in [0, _n_bins), c_k in [_n_bins, 2 * _n_bins)
+    cplx *_phasors;
+    // 2 * cos(omega_k)
+    Float *_cosines;
+    Float *_resonators;
+    size_t _window_index;
+    size_t _window_size;
+    size_t _n_bins;
+    // whether all c_k are 1, so that only one resonator per bin and component is needed
+    bool _integral;
+    // whether the resonators grow without bound, so that they have to be primed again every _window_size pushes
+    bool _restart;
+    bool _finite;
+    enum sdft_SignalTraits _signal_traits;
+};
+
+// A sliding constant-Q transform, see sdft_init_constant_q_from_buffers.
+//
+// Each bin is updated like a non-integral bin of Impl, X_k' = w_k * (X_k + c_k * x_new - x_old_k), only that x_old_k
+// is the sample pushed _lengths[k] samples ago.
+template<typename Float>
+struct ConstantQ : public TypedState<Float> {
+    ConstantQ(void *window, void *spectrum, void *coefficients, size_t *lengths, size_t window_size,
+            enum sdft_SignalTraits signal_traits, double min_frequency, size_t bins_per_octave, size_t n_bins);
+
+    sdft_Error validate();
+
+    void clear();
+
+    size_t get_window_size() const
+    {
+        return _window_size;
+    }
+
+    size_t get_number_of_bins() const
+    {
+        return _n_bins;
+    }
+
+    sdft_Error push_next_sample(void *next_sample);
+
+    sdft_Error check_samples(const void *samples, size_t n_samples) const
+    {
+        return check_signal_traits(_signal_traits, (const std::complex<Float> *) samples, n_samples);
+    }
+
+    void *get_spectrum()
+    {
+        return _spectrum;
+    }
+
+    void *unshift_and_get_window();
+
+    double get_bin_frequency(size_t bin)
+    {
+        if (bin >= _n_bins) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return _min_frequency * std::pow(2.0, static_cast<double>(bin) / _bins_per_octave);
+    }
+
+    sdft_Error combine_with(struct sdft_State *other, void *buffer)
+    {
+        ConstantQ<Float> *o = dynamic_cast<ConstantQ<Float> *>(other);
+        if (o != 0 && o->_window_size == _window_size && o->_signal_traits == _signal_traits
+                && o->_n_bins == _n_bins && std::equal(_lengths, _lengths + _n_bins, o->_lengths)
+                && std::equal(_phase_offsets, _phase_offsets + 2 * _n_bins, o->_phase_offsets)) {
+            new(buffer) Combined<ConstantQ<Float> >(this, o);
+            return SDFT_NO_ERROR;
+        }
+
+        return SDFT_NOT_COMBINABLE;
+    }
+
+private:
+    typedef std::complex<Float> cplx;
+
+    cplx *_window;
+    cplx *_spectrum;
+    // w_k in [0, _n_bins), c_k in [_n_bins, 2 * _n_bins)
+    cplx *_phase_offsets;
+    size_t *_lengths;
+    size_t _window_index;
+    size_t _window_size;
+    size_t _n_bins;
+    double _min_frequency;
+    size_t _bins_per_octave;
+    bool _valid_frequencies;
+    // the window length of the lowest bin
+    size_t _required_window_size;
+    enum sdft_SignalTraits _signal_traits;
+};
+
+// A decimating FIR low-pass filter in front of another state, optionally preceded by a mixer,
+// see sdft_init_decimating and sdft_init_zoom.
+template<typename Float>
+struct Decimating : public TypedState<Float> {
+    Decimating(TypedState<Float> *inner, size_t factor, size_t taps_per_phase, void *taps, void *history,
+            double center_frequency);
+
+    sdft_Error validate();
+
+    sdft_Error push_next_sample(void *next_sample);
+
+    sdft_Error check_samples(const void *samples, size_t n_samples) const
+    {
+        // The taps are real, so without mixing the decimated samples keep the signal traits of the input. With mixing,
+        // inner takes any complex sample, see validate. Cosine states only take the real part.
+        if (_center_frequency != 0 || _inner->get_sample_size() != sizeof(cplx)) {
+            return SDFT_NO_ERROR;
+        }
+
+        return _inner->check_samples(samples, n_samples);
+    }
+
+    void *get_spectrum()
+    {
+        return _inner->get_spectrum();
+    }
+
+    void *unshift_and_get_window()
+    {
+        return _inner->unshift_and_get_window();
+    }
+
+    enum sdft_Error combine_with(struct sdft_State *, void *)
+    {
+        return SDFT_NOT_COMBINABLE;
+    }
+
+    double get_bin_frequency(size_t bin)
+    {
+        double baseband = _inner->get_bin_frequency(bin);
+        if (baseband >= 0.5) {
+            // the upper half of the bins of inner are negative frequencies
+            baseband -= 1;
+        }
+
+        const double frequency = _center_frequency + baseband / _factor;
+        return frequency - std::floor(frequency);
+    }
+
+    size_t get_number_of_bins() const
+    {
+        return _inner->get_number_of_bins();
+    }
+
+private:
+    typedef std::complex<Float> cplx;
+
+    TypedState<Float> *_inner;
+    double _center_frequency;
+    // the current phasor of the oscillator and its rotation per sample, or 1 and 1 if not mixing
+    cplx _oscillator;
+    cplx _oscillator_step;
+    Float *_taps;
+    // The last _n_taps samples, stored twice in a row so that they can be read contiguously starting at
+    // _history_index.
+    cplx *_history;
+    size_t _factor;
+    size_t _n_taps;
+    size_t _history_index;
+    // the number of samples pushed since the last output
+    size_t _phase;
+};
+
+// A bank of leaky resonators, see sdft_init_leaky_from_buffers.
+//
+// Each bin is updated like a bin of Impl without the outgoing sample, X_k' = p_k * (X_k + x_new) with the pole
+// p_k = lambda * w_k inside the unit circle, so the samples are weighted by an exponentially decaying window instead of
+// a rectangular one and no window has to be kept.
+template<typename Float>
+struct Leaky : public TypedState<Float> {
+    Leaky(void *spectrum, void *poles, size_t window_size, enum sdft_SignalTraits signal_traits,
+            double time_constant);
+
+    sdft_Error validate();
+
+    sdft_Error push_next_sample(void *next_sample);
+
+    sdft_Error check_samples(const void *samples, size_t n_samples) const
+    {
+        return check_signal_traits(_signal_traits, (const std::complex<Float> *) samples, n_samples);
+    }
+
+    void *get_spectrum()
+    {
+        return _spectrum;
+    }
+
+    void *unshift_and_get_window()
+    {
+        return 0;
+    }
+
+    enum sdft_Error combine_with(struct sdft_State *, void *)
+    {
+        return SDFT_NOT_COMBINABLE;
+    }
+
+    sdft_Error enable_averaging(void *averaged_power, double time_constant, size_t hop_size)
+    {
+        _averaging.enable(averaged_power, _spectrum, get_number_of_bins(), time_constant, hop_size);
+        return SDFT_NO_ERROR;
+    }
+
+    void *get_averaged_power()
+    {
+        return _averaging._power;
+    }
+
+    double get_bin_frequency(size_t bin)
+    {
+        if (bin >= get_number_of_bins()) {
+            return std::numeric_limits<double>::quiet_NaN();
+        }
+
+        return static_cast<double>(bin) / _window_size;
+    }
+
+    size_t get_number_of_bins() const
+    {
+        return _signal_traits == SDFT_REAL_AND_IMAG
+                ? _window_size
+                : _window_size / 2; // only first half of spectrum relevant
+    }
+
+private:
+    typedef std::complex<Float> cplx;
+
+    cplx *_spectrum;
+    // lambda * w_k with lambda = exp(-1 / _time_constant)
+    cplx *_poles;
+    size_t _window_size;
+    enum sdft_SignalTraits _signal_traits;
+    double _time_constant;
+    Averaging<Float> _averaging;
+};
+
+//
+// Implementations of exported functions
+//
+
+size_t sdft_size_of_state()
+{
+    size_t size = sizeof(struct Impl<long double>);
+    size = std::max(size, sizeof(struct Combined<Impl<long double> >));
+    size = std::max(size, sizeof(struct SharedCombined<long double>));
+    size = std::max(size, sizeof(struct FlatView<long double>));
+    size = std::max(size, sizeof(struct Paired<long double>));
+    size = std::max(size, sizeof(struct Cosine<long double>));
+    size = std::max(size, sizeof(struct Combined<Cosine<long double> >));
+    size = std::max(size, sizeof(struct Goertzel<long double>));
+    size = std::max(size, sizeof(struct Combined<Goertzel<long double> >));
+    size = std::max(size, sizeof(struct ConstantQ<long double>));
+    size = std::max(size, sizeof(struct Combined<ConstantQ<long double> >));
+    size = std::max(size, sizeof(struct Decimating<long double>));
+    size = std::max(size, sizeof(struct Leaky<long double>));
+    return size;
+}
+
+// Returns the quality factor of a constant-Q transform, i.e. the number of periods in the window of each bin.
+static double constant_q_quality(size_t bins_per_octave)
+{
+    return 1 / (std::pow(2.0, 1.0 / bins_per_octave) - 1);
+}
+
+static size_t constant_q_length(double frequency, size_t bins_per_octave)
+{
+    return static_cast<size_t>(std::max(1.0, std::ceil(constant_q_quality(bins_per_octave) / frequency)));
+}
+
+static bool valid_constant_q_parameters(double min_frequency, size_t bins_per_octave)
+{
+    return bins_per_octave >= 1 && min_frequency > 0 && std::isfinite(min_frequency);
+}
+
+size_t sdft_constant_q_window_size(double min_frequency, size_t bins_per_octave)
+{
+    if (!valid_constant_q_parameters(min_frequency, bins_per_octave)) {
+        return 0;
+    }
+
+    return constant_q_length(min_frequency, bins_per_octave);
+}
+
+enum sdft_Error sdft_init_from_buffers(
+        struct sdft_State *s,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *spectrum,
+        void *buffer,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits)
+{
+
+    switch (precision) {
+        case SDFT_SINGLE:
+            new(s) Impl<float>(window, spectrum, buffer, window_size, signal_traits);
+            break;
+        case SDFT_DOUBLE:
+            new(s) Impl<double>(window, spectrum, buffer, window_size, signal_traits);
+            break;
+        case SDFT_LONG_DOUBLE:
+            new(s) Impl<long double>(window, spectrum, buffer, window_size, signal_traits);
+            break;
+    }
+
+    return s->validate();
+}
+
+enum sdft_Error sdft_init_from_bins(
+        struct sdft_State *s,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *spectrum,
+        void *phase_offsets,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        const double *bins,
+        size_t n_bins)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            new(s) Impl<float>(window, spectrum, phase_offsets, window_size, signal_traits, bins, n_bins);
+            break;
+        case SDFT_DOUBLE:
+            new(s) Impl<double>(window, spectrum, phase_offsets, window_size, signal_traits, bins, n_bins);
+            break;
+        case SDFT_LONG_DOUBLE:
+            new(s) Impl<long double>(window, spectrum, phase_offsets, window_size, signal_traits, bins, n_bins);
+            break;
+    }
+
+    return s->validate();
+}
+
+enum sdft_Error sdft_init_constant_q_from_buffers(
+        struct sdft_State *s,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *spectrum,
+        void *coefficients,
+        size_t *lengths,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        double min_frequency,
+        size_t bins_per_octave,
+        size_t n_bins)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            new(s) ConstantQ<float>(window, spectrum, coefficients, lengths, window_size, signal_traits,
+                    min_frequency, bins_per_octave, n_bins);
+            break;
+        case SDFT_DOUBLE:
+            new(s) ConstantQ<double>(window, spectrum, coefficients, lengths, window_size, signal_traits,
+                    min_frequency, bins_per_octave, n_bins);
+            break;
+        case SDFT_LONG_DOUBLE:
+            new(s) ConstantQ<long double>(window, spectrum, coefficients, lengths, window_size, signal_traits,
+                    min_frequency, bins_per_octave, n_bins);
+            break;
+    }
+
+    return s->validate();
+}
+
+enum sdft_Error sdft_init_dct_from_buffers(
+        struct sdft_State *s,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *coefficients,
+        void *twiddles,
+        size_t window_size,
+        enum sdft_CosineKind kind)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            new(s) Cosine<float>(window, coefficients, twiddles, window_size, kind);
+            break;
+        case SDFT_DOUBLE:
+            new(s) Cosine<double>(window, coefficients, twiddles, window_size, kind);
+            break;
+        case SDFT_LONG_DOUBLE:
+            new(s) Cosine<long double>(window, coefficients, twiddles, window_size, kind);
+            break;
+    }
+
+    return s->validate();
+}
+
+enum sdft_Error sdft_init_goertzel_from_buffers(
+        struct sdft_State *s,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *spectrum,
+        void *coefficients,
+        void *resonators,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        const double *bins,
+        size_t n_bins)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            new(s) Goertzel<float>(window, spectrum, coefficients, resonators, window_size, signal_traits, bins,
+                    n_bins);
+            break;
+        case SDFT_DOUBLE:
+            new(s) Goertzel<double>(window, spectrum, coefficients, resonators, window_size, signal_traits, bins,
+                    n_bins);
+            break;
+        case SDFT_LONG_DOUBLE:
+            new(s) Goertzel<long double>(window, spectrum, coefficients, resonators, window_size, signal_traits, bins,
+                    n_bins);
+            break;
+    }
+
+    return s->validate();
+}
+
+enum sdft_Error sdft_init_leaky_from_buffers(
+        struct sdft_State *s,
+        enum sdft_FloatPrecision precision,
+        void *spectrum,
+        void *poles,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        double time_constant)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            new(s) Leaky<float>(spectrum, poles, window_size, signal_traits, time_constant);
+            break;
+        case SDFT_DOUBLE:
+            new(s) Leaky<double>(spectrum, poles, window_size, signal_traits, time_constant);
+            break;
+        case SDFT_LONG_DOUBLE:
+            new(s) Leaky<long double>(spectrum, poles, window_size, signal_traits, time_constant);
+            break;
+    }
+
+    return s->validate();
+}
+
+enum sdft_Error sdft_init_combine(struct sdft_State *state, struct sdft_State *first, struct sdft_State *second)
+{
+    sdft_Error err = first->combine_with(second, state);
+    if (err != SDFT_NO_ERROR) {
+        return err;
+    }
+
+    return state->validate();
+}
+
+enum sdft_Error sdft_init_shared_combined(
+        struct sdft_State *s,
+        enum sdft_FloatPrecision precision,
+        void *window,
+        void *spectra,
+        void *phase_offsets,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            new(s) SharedCombined<float>(window, spectra, phase_offsets, window_size, signal_traits);
+            break;
+        case SDFT_DOUBLE:
+            new(s) SharedCombined<double>(window, spectra, phase_offsets, window_size, signal_traits);
+            break;
+        case SDFT_LONG_DOUBLE:
+            new(s) SharedCombined<long double>(window, spectra, phase_offsets, window_size, signal_traits);
+            break;
+    }
+
+    return s->validate();
+}
+
+// The buffers of a sdft_FlatState start at multiples of this, so that they don't share cache lines.
+static const size_t flat_alignment = 64;
+
+static size_t align_flat(size_t offset)
+{
+    return (offset + flat_alignment - 1) / flat_alignment * flat_alignment;
+}
+
+static size_t size_of_complex(enum sdft_FloatPrecision precision)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            return sizeof(std::complex<float>);
+        case SDFT_DOUBLE:
+            return sizeof(std::complex<double>);
+        default:
+            return sizeof(std::complex<long double>);
+    }
+}
+
+// Computes the layout of a sdft_FlatState, returns its size, or 0 if the block would not be addressable.
+static size_t layout_flat(enum sdft_FloatPrecision precision, size_t window_size, enum sdft_FlatKind kind,
+        struct sdft_FlatState *flat)
+{
+    const size_t window_offset = align_flat(sizeof(struct sdft_FlatState));
+    // the window, the spectra and the phase offsets each take an aligned buffer, which all have to fit behind the
+    // header
+    const size_t n_buffers = kind == SDFT_FLAT_COMBINED ? 4 : 3;
+    size_t max_buffer_size = (std::numeric_limits<size_t>::max() - window_offset) / n_buffers;
+    max_buffer_size -= max_buffer_size % flat_alignment;
+    if (window_size > max_buffer_size / size_of_complex(precision)) {
+        return 0;
+    }
+
+    const size_t buffer_size = align_flat(window_size * size_of_complex(precision));
+    const size_t spectra_offset = window_offset + buffer_size;
+    const size_t phase_offsets_offset = spectra_offset + (kind == SDFT_FLAT_COMBINED ? 2 : 1) * buffer_size;
+    if (flat != 0) {
+        flat->window_offset = window_offset;
+        flat->spectra_offset = spectra_offset;
+        flat->phase_offsets_offset = phase_offsets_offset;
+    }
+
+    return phase_offsets_offset + buffer_size;
+}
+
+template<typename Float>
+static void init_flat(struct sdft_FlatState *flat)
+{
+    char *block = (char *) flat;
+    std::complex<Float> *window = (std::complex<Float> *) (block + flat->window_offset);
+    std::complex<Float> *spectra = (std::complex<Float> *) (block + flat->spectra_offset);
+    const size_t n_spectra = flat->kind == SDFT_FLAT_COMBINED ? 2 : 1;
+
+    std::fill(window, window + flat->window_size, std::complex<Float>(0));
+    std::fill(spectra, spectra + n_spectra * flat->window_size, std::complex<Float>(0));
+    generate_dft_phase_offsets((std::complex<Float> *) (block + flat->phase_offsets_offset),
+            static_cast<size_t>(flat->window_size));
+}
+
+size_t sdft_flat_size(enum sdft_FloatPrecision precision, size_t window_size, enum sdft_FlatKind kind)
+{
+    return layout_flat(precision, window_size, kind, 0);
+}
+
+enum sdft_Error sdft_init_flat(
+        struct sdft_FlatState *flat,
+        enum sdft_FloatPrecision precision,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        enum sdft_FlatKind kind)
+{
+    if (window_size < 1) {
+        return SDFT_WINDOW_TOO_SHORT;
+    }
+
+    if (layout_flat(precision, window_size, kind, 0) == 0) {
+        return SDFT_NOT_SUPPORTED;
+    }
+
+    std::memset(flat, 0, sizeof(*flat));
+    flat->magic = SDFT_FLAT_MAGIC;
+    flat->precision = precision;
+    flat->kind = kind;
+    flat->signal_traits = signal_traits;
+    flat->window_size = window_size;
+    flat->size = layout_flat(precision, window_size, kind, flat);
+
+    switch (precision) {
+        case SDFT_SINGLE:
+            init_flat<float>(flat);
+            break;
+        case SDFT_DOUBLE:
+            init_flat<double>(flat);
+            break;
+        case SDFT_LONG_DOUBLE:
+            init_flat<long double>(flat);
+            break;
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+enum sdft_Error sdft_init_from_flat(struct sdft_State *s, struct sdft_FlatState *flat)
+{
+    // the header has to describe exactly the layout sdft_init_flat would have produced
+    struct sdft_FlatState expected;
+    if (flat->magic != SDFT_FLAT_MAGIC || flat->precision > SDFT_LONG_DOUBLE || flat->kind > SDFT_FLAT_COMBINED
+            || flat->signal_traits > SDFT_IMAG_ONLY || flat->window_size < 1
+            || flat->window_size > std::numeric_limits<size_t>::max() / flat_alignment
+            || flat->window_index >= flat->window_size || flat->clear_counter > 2 * flat->window_size) {
+        return SDFT_INVALID_FLAT_STATE;
+    }
+    const size_t size = layout_flat((enum sdft_FloatPrecision) flat->precision,
+            static_cast<size_t>(flat->window_size), (enum sdft_FlatKind) flat->kind, &expected);
+    if (size == 0 || flat->size != size || flat->window_offset != expected.window_offset
+            || flat->spectra_offset != expected.spectra_offset
+            || flat->phase_offsets_offset != expected.phase_offsets_offset) {
+        return SDFT_INVALID_FLAT_STATE;
+    }
+
+    switch (flat->precision) {
+        case SDFT_SINGLE:
+            new(s) FlatView<float>(flat);
+            break;
+        case SDFT_DOUBLE:
+            new(s) FlatView<double>(flat);
+            break;
+        default:
+            new(s) FlatView<long double>(flat);
+            break;
+    }
+
+    return s->validate();
+}
+
+const void *sdft_flat_get_spectrum(const struct sdft_FlatState *flat)
+{
+    const bool second = flat->kind == SDFT_FLAT_COMBINED && flat->clear_counter > flat->window_size;
+    return (const char *) flat + flat->spectra_offset
+            + (second ? flat->window_size * size_of_complex((enum sdft_FloatPrecision) flat->precision) : 0);
+}
+
+enum sdft_Error sdft_init_paired(
+        struct sdft_State *state,
+        struct sdft_State *first,
+        struct sdft_State *second,
+        void *cross_spectrum,
+        void *auto_spectra,
+        double time_constant)
+{
+    sdft_Error err = first->pair_with(second, state, cross_spectrum, auto_spectra, time_constant);
+    if (err != SDFT_NO_ERROR) {
+        return err;
+    }
+
+    return state->validate();
+}
+
+enum sdft_Error sdft_init_decimating(
+        struct sdft_State *state,
+        struct sdft_State *inner,
+        size_t factor,
+        size_t taps_per_phase,
+        void *taps,
+        void *history)
+{
+    return sdft_init_zoom(state, inner, 0, factor, taps_per_phase, taps, history);
+}
+
+enum sdft_Error sdft_init_zoom(
+        struct sdft_State *state,
+        struct sdft_State *inner,
+        double center_frequency,
+        size_t factor,
+        size_t taps_per_phase,
+        void *taps,
+        void *history)
+{
+    if (TypedState<float> *i = dynamic_cast<TypedState<float> *>(inner)) {
+        new(state) Decimating<float>(i, factor, taps_per_phase, taps, history, center_frequency);
+    } else if (TypedState<double> *i = dynamic_cast<TypedState<double> *>(inner)) {
+        new(state) Decimating<double>(i, factor, taps_per_phase, taps, history, center_frequency);
+    } else if (TypedState<long double> *i = dynamic_cast<TypedState<long double> *>(inner)) {
+        new(state) Decimating<long double>(i, factor, taps_per_phase, taps, history, center_frequency);
+    }
+
+    return state->validate();
+}
+
+enum sdft_Error sdft_push_next_sample(struct sdft_State *s, void *next_sample)
+{
+    if (s->_latency_histogram != 0 && ++s->_latency_counter == s->_latency_interval) {
+        s->_latency_counter = 0;
+        unsigned long long start = read_latency_ticks();
+        enum sdft_Error err = s->push_next_sample(next_sample);
+        unsigned long long ticks = read_latency_ticks() - start;
+
+        struct sdft_LatencyHistogram *h = s->_latency_histogram;
+        h->counts[latency_bucket(ticks)]++;
+        // min is unset in a zero-initialized histogram
+        h->min = h->total_count == 0 ? ticks : std::min(h->min, ticks);
+        h->total_count++;
+        h->max = std::max(h->max, ticks);
+        return err;
+    }
+
+    return s->push_next_sample(next_sample);
+}
+
+enum sdft_Error sdft_skip_samples(struct sdft_State *s, size_t n_samples, const void *fill)
+{
+    return s->skip_samples(n_samples, fill);
+}
+
+enum sdft_Error sdft_catch_up(struct sdft_State *s, const void *samples, size_t n_samples)
+{
+    return s->catch_up(samples, n_samples);
+}
+
+enum sdft_Error sdft_check_samples(struct sdft_State *s, const void *samples, size_t n_samples)
+{
+    return s->check_samples(samples, n_samples);
+}
+
+enum sdft_Error sdft_resize(struct sdft_State *s, size_t window_size, void *window, void *spectrum,
+        void *phase_offsets)
+{
+    return s->resize(window_size, window, spectrum, phase_offsets);
+}
+
+void *sdft_get_spectrum(struct sdft_State *s)
+{
+    return s->get_spectrum();
+}
+
+void *sdft_unshift_and_get_window(struct sdft_State *s)
+{
+    return s->unshift_and_get_window();
+}
+
+enum sdft_FloatPrecision sdft_get_precision(struct sdft_State *s)
+{
+    return s->get_precision();
+}
+
+size_t sdft_get_sample_size(struct sdft_State *s)
+{
+    return s->get_sample_size();
+}
+
+size_t sdft_get_number_of_bins(struct sdft_State *s)
+{
+    return s->get_number_of_bins();
+}
+
+double sdft_get_bin_frequency(struct sdft_State *s, size_t bin)
+{
+    return s->get_bin_frequency(bin);
+}
+
+enum sdft_Error sdft_enable_averaging(
+        struct sdft_State *s,
+        void *averaged_power,
+        double time_constant,
+        size_t hop_size)
+{
+    // also catches NaN
+    if (!(time_constant >= 0)) {
+        return SDFT_INVALID_TIME_CONSTANT;
+    }
+
+    if (hop_size < 1) {
+        return SDFT_INVALID_HOP_SIZE;
+    }
+
+    return s->enable_averaging(averaged_power, time_constant, hop_size);
+}
+
+enum sdft_Error sdft_enable_lazy_rotation(struct sdft_State *s, int enable)
+{
+    return s->enable_lazy_rotation(enable != 0);
+}
+
+void *sdft_get_averaged_power(struct sdft_State *s)
+{
+    return s->get_averaged_power();
+}
+
+enum sdft_Error sdft_enable_latency_histogram(
+        struct sdft_State *s,
+        struct sdft_LatencyHistogram *histogram,
+        size_t sample_interval)
+{
+    if (sample_interval < 1) {
+        return SDFT_INVALID_HOP_SIZE;
+    }
+
+    s->_latency_histogram = histogram;
+    s->_latency_interval = sample_interval;
+    s->_latency_counter = 0;
+    return SDFT_NO_ERROR;
+}
+
+void sdft_reset_latency_histogram(struct sdft_LatencyHistogram *histogram)
+{
+    std::memset(histogram, 0, sizeof(*histogram));
+    histogram->min = ~0ull;
+}
+
+void sdft_merge_latency_histograms(struct sdft_LatencyHistogram *into, const struct sdft_LatencyHistogram *from)
+{
+    for (size_t i = 0; i < SDFT_LATENCY_BUCKETS; ++i) {
+        into->counts[i] += from->counts[i];
+    }
+    into->total_count += from->total_count;
+    // a zero-initialized histogram has min == 0 but nothing recorded
+    if (from->total_count > 0) {
+        into->min = into->total_count == from->total_count ? from->min : std::min(into->min, from->min);
+        into->max = std::max(into->max, from->max);
+    }
+}
+
+unsigned long long sdft_get_latency_percentile(const struct sdft_LatencyHistogram *histogram, double percentile)
+{
+    // NaN fails the comparisons as well, which would have no rank to convert
+    if (histogram->total_count == 0 || !(percentile >= 0 && percentile <= 100)) {
+        return 0;
+    }
+
+    // the rank of the percentile, in [1, total_count]
+    double rank = std::ceil(percentile / 100 * histogram->total_count);
+    unsigned long long target = rank < 1 ? 1 : rank > histogram->total_count ? histogram->total_count
+            : static_cast<unsigned long long>(rank);
+
+    unsigned long long count = 0;
+    for (size_t i = 0; i < SDFT_LATENCY_BUCKETS; ++i) {
+        count += histogram->counts[i];
+        if (count >= target) {
+            return std::max(histogram->min, std::min(histogram->max, latency_bucket_upper_bound(i)));
+        }
+    }
+
+    return histogram->max;
+}
+
+static double measure_latency_tick_rate()
+{
+#ifdef SDFT_HAVE_RDTSC
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long long start_ticks = read_latency_ticks();
+    std::chrono::duration<double> elapsed;
+    do {
+        elapsed = std::chrono::steady_clock::now() - start;
+    } while (elapsed.count() < 0.01);
+
+    return (read_latency_ticks() - start_ticks) / elapsed.count();
+#else
+    return 1e9;
+#endif
+}
+
+double sdft_get_latency_tick_rate()
+{
+    static const double rate = measure_latency_tick_rate();
+    return rate;
+}
+
+void *sdft_get_cross_spectrum(struct sdft_State *s)
+{
+    return s->get_cross_spectrum();
+}
+
+void *sdft_get_auto_spectrum(struct sdft_State *s, size_t channel)
+{
+    return s->get_auto_spectrum(channel);
+}
+
+enum sdft_Error sdft_get_coherence(struct sdft_State *s, void *coherence)
+{
+    return s->get_coherence(coherence);
+}
+
+//
+// Templated implementations of the precision dependent functions
+//
+
+template<typename Float>
+Impl<Float>::Impl(void *signal, void *spectrum, void *phase_offsets,
+        size_t window_size, enum sdft_SignalTraits signal_traits)
+        : _window((cplx *) signal), _spectrum((cplx *) spectrum), _phase_offsets((cplx *) phase_offsets),
+          _corrections(0), _window_index(0), _pending_rotation(0), _window_size(window_size), _n_bins(window_size),
+          _finite(true), _lazy_rotation(false), _signal_traits(signal_traits)
+{
+    generate_dft_phase_offsets(_phase_offsets, window_size);
+}
+
+template<typename Float>
+Impl<Float>::Impl(void *signal, void *spectrum, void *phase_offsets, size_t window_size,
+        enum sdft_SignalTraits signal_traits, const double *bins, size_t n_bins)
+        : _window((cplx *) signal), _spectrum((cplx *) spectrum), _phase_offsets((cplx *) phase_offsets),
+          _corrections((cplx *) phase_offsets + n_bins), _window_index(0), _pending_rotation(0),
+          _window_size(window_size), _n_bins(n_bins), _finite(true), _lazy_rotation(false),
+          _signal_traits(signal_traits)
+{
+    for (size_t k = 0; k < n_bins; ++k) {
+        _finite = _finite && std::isfinite(bins[k]);
+    }
+
+    if (!_finite || window_size < 1) {
+        return;
+    }
+
+    // The window holds bins[k] periods of bin k, so the incoming sample has to be weighted with
+    // exp(-2 * pi * i * bins[k]) to continue the phase of the outgoing one, see the Goertzel state.
+    for (size_t k = 0; k < n_bins; ++k) {
+        _phase_offsets[k] = unit_phasor<Float>(static_cast<long double>(bins[k]) / window_size);
+        _corrections[k] = unit_phasor<Float>(-static_cast<long double>(bins[k]));
+    }
+}
+
+template<typename Float>
+bool Impl<Float>::matches_signal_trait(typename Impl::cplx const &c) const
+{
+    return ::matches_signal_trait(_signal_traits, c);
+}
+
+template<typename Float>
+sdft_Error Impl<Float>::validate()
+{
+    // the window should be of at least length 1
+    if (_window_size < 1) {
+        return SDFT_WINDOW_TOO_SHORT;
+    }
+
+    if (_n_bins < 1 || !_finite) {
+        return SDFT_INVALID_FREQUENCIES;
+    }
+
+    // check for violations of the signal traits
+    for (size_t i = 0; i < _window_size; ++i) {
+        if (!matches_signal_trait(_window[i])) {
+            return SDFT_SIGNAL_TRAIT_VIOLATION;
+        }
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+void Impl<Float>::clear()
+{
+    for (size_t i = 0; i < _window_size; ++i) {
+        _window[i] = 0;
+    }
+
+    for (size_t i = 0; i < _n_bins; ++i) {
+        _spectrum[i] = 0;
+    }
+
+    _window_index = 0;
+    _pending_rotation = 0;
+}
+
+template<typename Float>
+sdft_Error Impl<Float>::push_next_sample(void *next_sample)
+{
+    assert(_window_index < _window_size);
+
+    cplx ns = *(cplx *) next_sample;
+
+    if (!matches_signal_trait(ns)) {
+        return SDFT_SIGNAL_TRAIT_VIOLATION;
+    }
+
+    if (_corrections != 0) {
+        return push_next_sample_to_bins(ns);
+    }
+
+    cplx delta = advance_window(ns);
+    if (_lazy_rotation && delta == cplx(0)) {
+        // The incoming sample equals the outgoing one, e.g. during silence, so the push only rotates bin k by w_k.
+        // Such pushes are counted and rotated by w_k^m at once when needed, and the power does not change by rotating.
+        if (++_pending_rotation == _window_size) {
+            _pending_rotation = 0;
+        }
+        if (_averaging.next_push_is_hop()) {
+            for (size_t i = 0; i < get_number_of_bins(); ++i) {
+                _averaging.update(i, _spectrum[i]);
+            }
+        }
+        return SDFT_NO_ERROR;
+    }
+
+    apply_pending_rotation();
+    slide_dft_bins(_spectrum, _phase_offsets, get_number_of_bins(), delta, _averaging);
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+sdft_Error Impl<Float>::skip_samples(size_t n_samples, const void *fill)
+{
+    const cplx f = fill != 0 ? *(const cplx *) fill : cplx(0);
+    if (!matches_signal_trait(f)) {
+        return SDFT_SIGNAL_TRAIT_VIOLATION;
+    }
+
+    if (_corrections != 0) {
+        return sdft_State::skip_samples(n_samples, fill);
+    }
+
+    // With W = e^{2 pi i / N}, the window x (oldest sample first) becomes y with y_j = x_{j+K} for j < N - K and
+    // y_j = f otherwise, so
+    //
+    //     Y_k = W^{kK} sum_{m=K}^{N-1} x_m W^{-km} + f sum_{m=1}^{K} W^{km}
+    //
+    // where the first sum is X_k minus the K outgoing samples. Whichever of the outgoing and the remaining samples
+    // are fewer are summed, the twiddles are exact entries of the table of phase offsets. That costs O(N) per summed
+    // sample, so if more than log2(N) samples would have to be summed, the FFT of the new window is cheaper.
+    apply_pending_rotation();
+    const size_t N = _window_size;
+    const size_t K = std::min(n_samples, N);
+    const bool subtract_outgoing = K <= N - K;
+    size_t log2_N = 0;
+    while ((static_cast<size_t>(1) << log2_N) < N) {
+        ++log2_N;
+    }
+    if (is_power_of_two(N) && std::min(K, N - K) > log2_N) {
+        for (size_t j = 0; j < K; ++j) {
+            _window[(_window_index + j) % N] = f;
+        }
+        _window_index = (_window_index + n_samples % N) % N;
+        dft_of_window(_spectrum, _window, _window_index, _phase_offsets, N, _signal_traits);
+        _averaging.skip(n_samples, _spectrum, get_number_of_bins());
+
+        return SDFT_NO_ERROR;
+    }
+
+    const long double pi = 3.141592653589793238462643383279502884L;
+    for (size_t k = 0; k < get_number_of_bins(); ++k) {
+        const size_t begin = subtract_outgoing ? 0 : K;
+        const size_t end = subtract_outgoing ? K : N;
+        cplx sum(0);
+        size_t offset = k * begin % N;
+        size_t position = (_window_index + begin) % N;
+        for (size_t m = begin; m < end; ++m) {
+            sum += _window[position] * std::conj(_phase_offsets[offset]);
+            offset += k;
+            if (offset >= N) {
+                offset -= N;
+            }
+            if (++position == N) {
+                position = 0;
+            }
+        }
+        cplx Y = (subtract_outgoing ? _spectrum[k] - sum : sum) * _phase_offsets[k * K % N];
+
+        if (f != cplx(0)) {
+            // the geometric sum as e^{pi i k (K + 1) / N} sin(pi k K / N) / sin(pi k / N), avoiding the cancellation
+            // of (W^{kK} - 1) / (W^k - 1) for low bins of long windows
+            Y += k == 0 ? f * static_cast<Float>(K) : f * unit_phasor<Float>(
+                    static_cast<long double>(k * (K + 1) % (2 * N)) / (2 * N))
+                    * static_cast<Float>(std::sin(pi * static_cast<long double>(k * K % (2 * N)) / N)
+                            / std::sin(pi * static_cast<long double>(k) / N));
+        }
+        _spectrum[k] = Y;
+    }
+
+    for (size_t j = 0; j < K; ++j) {
+        _window[(_window_index + j) % N] = f;
+    }
+    _window_index = (_window_index + n_samples % N) % N;
+    _averaging.skip(n_samples, _spectrum, get_number_of_bins());
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+sdft_Error Impl<Float>::catch_up(const void *samples, size_t n_samples)
+{
+    const size_t N = _window_size;
+    if (n_samples < N) {
+        return sdft_State::catch_up(samples, n_samples);
+    }
+
+    // only the last N samples end up in the window, so only they are checked
+    const cplx *last = (const cplx *) samples + (n_samples - N);
+    enum sdft_Error err = check_samples(last, N);
+    if (err != SDFT_NO_ERROR) {
+        return err;
+    }
+
+    // the position at which pushing the samples one by one would have stored the oldest of them
+    const size_t start = (_window_index + (n_samples - N) % N) % N;
+    _pending_rotation = 0;
+    if (_corrections == 0) {
+        for (size_t j = 0; j < N; ++j) {
+            _window[(start + j) % N] = last[j];
+        }
+        _window_index = start;
+        dft_of_window(_spectrum, _window, _window_index, _phase_offsets, N, _signal_traits);
+    } else {
+        // push the window into a cleared state instead, leaving the averaged power to the update below
+        Averaging<Float> averaging = _averaging;
+        _averaging = Averaging<Float>();
+        std::fill(_window, _window + N, cplx(0));
+        std::fill(_spectrum, _spectrum + get_number_of_bins(), cplx(0));
+        _window_index = start;
+        for (size_t j = 0; j < N; ++j) {
+            push_next_sample(const_cast<cplx *>(last + j));
+        }
+        _averaging = averaging;
+    }
+    _averaging.skip(n_samples, _spectrum, get_number_of_bins());
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+sdft_Error Impl<Float>::resize(size_t window_size, void *window, void *spectrum, void *phase_offsets)
+{
+    if (_corrections != 0) {
+        return SDFT_NOT_SUPPORTED;
+    }
+    if (window_size < 1) {
+        return SDFT_WINDOW_TOO_SHORT;
+    }
+
+    // the most recent samples go to the end of the new window, preceded by zeros like in a fresh state
+    cplx *new_window = (cplx *) window;
+    const size_t n_kept = std::min(_window_size, window_size);
+    std::fill(new_window, new_window + (window_size - n_kept), cplx(0));
+    for (size_t j = 0; j < n_kept; ++j) {
+        new_window[window_size - n_kept + j] = _window[(_window_index + _window_size - n_kept + j) % _window_size];
+    }
+
+    _window = new_window;
+    _spectrum = (cplx *) spectrum;
+    _phase_offsets = (cplx *) phase_offsets;
+    _window_index = 0;
+    _pending_rotation = 0;
+    _window_size = window_size;
+    _n_bins = window_size;
+    // the buffer of the averaged power has the old number of bins
+    _averaging = Averaging<Float>();
+
+    generate_dft_phase_offsets(_phase_offsets, window_size);
+    dft_of_window(_spectrum, _window, _window_index, _phase_offsets, window_size, _signal_traits);
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+void Impl<Float>::apply_pending_rotation()
+{
+    if (_pending_rotation == 0) {
+        return;
+    }
+
+    // w_k^m = exp(2 * pi * i * k * m / N) is the phase offset of bin (k * m) mod N, so the table holds all of them
+    // exactly instead of accumulating the error of m multiplications.
+    const size_t m = _pending_rotation;
+    size_t offset = 0;
+    for (size_t k = 0; k < get_number_of_bins(); ++k) {
+        _spectrum[k] *= _phase_offsets[offset];
+        offset += m;
+        if (offset >= _window_size) {
+            offset -= _window_size;
+        }
+    }
+
+    _pending_rotation = 0;
+}
+
+template<typename Float>
+sdft_Error Impl<Float>::push_next_sample_to_bins(typename Impl::cplx const &ns)
+{
+    const cplx os = _window[_window_index];
+    advance_window(ns);
+
+    if (_averaging.next_push_is_hop()) {
+        Float *power = _averaging._power;
+        const Float alpha = _averaging._alpha;
+        for (size_t i = 0; i < _n_bins; ++i) {
+            const cplx X = (_spectrum[i] + _corrections[i] * ns - os) * _phase_offsets[i];
+            _spectrum[i] = X;
+            power[i] += alpha * (std::norm(X) - power[i]);
+        }
+    } else {
+        for (size_t i = 0; i < _n_bins; ++i) {
+            _spectrum[i] = (_spectrum[i] + _corrections[i] * ns - os) * _phase_offsets[i];
+        }
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+typename Impl<Float>::cplx Impl<Float>::advance_window(typename Impl::cplx const &ns)
+{
+    return advance_ring(_window, _window_size, _window_index, ns);
+}
+
+template<typename Float>
+void *Impl<Float>::unshift_and_get_window()
+{
+    assert(_window_size > _window_index);
+
+    // this cyclically shifts the element at _window_index to the front
+    std::rotate(_window, _window + _window_index, _window + _window_size);
+
+    _window_index = 0;
+    return _window;
+}
+
+template<typename State>
+Combined<State>::Combined(State *first, State *second)
+        : _first(first), _second(second), _window_size(first->get_window_size()), _clear_counter(0)
+{
+    _second->clear();
+}
+
+template<typename State>
+sdft_Error Combined<State>::validate()
+{
+    return SDFT_NO_ERROR;
+}
+
+template<typename State>
+sdft_Error Combined<State>::push_next_sample(void *next_sample)
+{
+    // Invariant: 0 <= _clear_counter <= _window_size
+    //                  iff _first has the valid spectrum
+    //            _window_size < _clear_counter <= 2*_window_size
+    //                  iff _second has the valid spectrum
+    assert(_clear_counter <= 2 * _window_size);
+
+    if (_clear_counter == _window_size) {
+        _first->clear();
+    } else if (_clear_counter == 2 * _window_size) {
+        _second->clear();
+        _clear_counter = 0;
+    }
+
+    enum sdft_Error err = _first->push_next_sample(next_sample);
+    if (err != SDFT_NO_ERROR) {
+        return err;
+    }
+
+    err = _second->push_next_sample(next_sample);
+    if (err != SDFT_NO_ERROR) {
+        return err;
+    }
+
+    _clear_counter++;
+
+    if (_averaging.next_push_is_hop()) {
+        const std::complex<Float> *spectrum = (std::complex<Float> *) get_spectrum();
+        size_t n_bins = _first->get_number_of_bins();
+        for (size_t i = 0; i < n_bins; ++i) {
+            _averaging.update(i, spectrum[i]);
+        }
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename State>
+sdft_Error Combined<State>::skip_samples(size_t n_samples, const void *fill)
+{
+    const size_t n_pushes = n_samples;
+    if (n_samples >= 2 * _window_size) {
+        // Each sub-state is cleared once every 2 * window_size pushes and holds only fill after that, so skipping a
+        // multiple of 2 * window_size samples less leaves both in the same state. This keeps the work bounded for
+        // kinds of sub-states which skip by pushing, and restarts them on the way.
+        n_samples = 2 * _window_size + n_samples % (2 * _window_size);
+    }
+
+    // in segments up to the next clear of push_next_sample
+    while (n_samples > 0) {
+        if (_clear_counter == _window_size) {
+            _first->clear();
+        } else if (_clear_counter == 2 * _window_size) {
+            _second->clear();
+            _clear_counter = 0;
+        }
+
+        const size_t n = std::min(n_samples,
+                (_clear_counter < _window_size ? _window_size : 2 * _window_size) - _clear_counter);
+        enum sdft_Error err = _first->skip_samples(n, fill);
+        if (err == SDFT_NO_ERROR) {
+            err = _second->skip_samples(n, fill);
+        }
+        if (err != SDFT_NO_ERROR) {
+            return err;
+        }
+        _clear_counter += n;
+        n_samples -= n;
+    }
+
+    _averaging.skip(n_pushes, (std::complex<Float> *) get_spectrum(), _first->get_number_of_bins());
+    return SDFT_NO_ERROR;
+}
+
+template<typename State>
+sdft_Error Combined<State>::catch_up(const void *samples, size_t n_samples)
+{
+    if (n_samples < _window_size) {
+        return sdft_State::catch_up(samples, n_samples);
+    }
+
+    // Only the last window_size samples matter: the first sub-state starts over with them, and the second one is cleared
+    // as push_next_sample does when the first one takes over.
+    // Nothing may be cleared before the samples are known to be valid.
+    const char *last = (const char *) samples + (n_samples - _window_size) * get_sample_size();
+    enum sdft_Error err = _first->check_samples(last, _window_size);
+    if (err != SDFT_NO_ERROR) {
+        return err;
+    }
+    _first->clear();
+    err = _first->catch_up(last, _window_size);
+    if (err != SDFT_NO_ERROR) {
+        return err;
+    }
+    _second->clear();
+    _clear_counter = 0;
+
+    _averaging.skip(n_samples, (std::complex<Float> *) get_spectrum(), _first->get_number_of_bins());
+    return SDFT_NO_ERROR;
+}
+
+template<typename State>
+sdft_Error Combined<State>::resize(size_t window_size, void *window, void *spectrum, void *phase_offsets)
+{
+    // Only the sub-state with the valid spectrum holds the whole window (see the invariant in push_next_sample), so it
+    // becomes the first one and carries over the samples. The second one is cleared right away as in catch_up.
+    const bool swap = _clear_counter > _window_size;
+    if (swap) {
+        std::swap(_first, _second);
+    }
+    const size_t offset = window_size * sizeof(std::complex<Float>);
+    enum sdft_Error err = _first->resize(window_size, window, spectrum, phase_offsets);
+    if (err != SDFT_NO_ERROR) {
+        // nothing changed
+        if (swap) {
+            std::swap(_first, _second);
+        }
+        return err;
+    }
+    err = _second->resize(window_size, (char *) window + offset, (char *) spectrum + offset,
+            (char *) phase_offsets + offset);
+    if (err != SDFT_NO_ERROR) {
+        return err;
+    }
+
+    _window_size = window_size;
+    _second->clear();
+    _clear_counter = 0;
+    _averaging = Averaging<Float>();
+    return SDFT_NO_ERROR;
+}
+
+template<typename State>
+void *Combined<State>::unshift_and_get_window()
+{
+    assert(_clear_counter <= 2 * _window_size);
+    // See the invariant in push_next_sample.
+    return _clear_counter <= _window_size
+            ? _first->unshift_and_get_window()
+            : _second->unshift_and_get_window();
+}
+
+template<typename Float>
+SharedCombined<Float>::SharedCombined(void *window, void *spectra, void *phase_offsets, size_t window_size,
+        enum sdft_SignalTraits signal_traits)
+        : _window((cplx *) window), _phase_offsets((cplx *) phase_offsets), _window_index(0),
+          _window_size(window_size), _signal_traits(signal_traits), _clear_counter(0)
+{
+    _spectra[0] = (cplx *) spectra;
+    _spectra[1] = (cplx *) spectra + window_size;
+    generate_dft_phase_offsets(_phase_offsets, window_size);
+
+    // like Combined, which clears its second state right away
+    std::fill(_spectra[1], _spectra[1] + window_size, cplx(0));
+}
+
+template<typename Float>
+sdft_Error SharedCombined<Float>::validate()
+{
+    if (_window_size < 1) {
+        return SDFT_WINDOW_TOO_SHORT;
+    }
+
+    for (size_t i = 0; i < _window_size; ++i) {
+        if (!matches_signal_trait(_signal_traits, _window[i])) {
+            return SDFT_SIGNAL_TRAIT_VIOLATION;
+        }
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+sdft_Error SharedCombined<Float>::push_next_sample(void *next_sample)
+{
+    const cplx ns = *(cplx *) next_sample;
+    if (!matches_signal_trait(_signal_traits, ns)) {
+        return SDFT_SIGNAL_TRAIT_VIOLATION;
+    }
+
+    push_shared_combined(_window, _spectra, _phase_offsets, _window_size, get_number_of_bins(), _window_index,
+            _clear_counter, ns, _averaging);
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+void *SharedCombined<Float>::unshift_and_get_window()
+{
+    assert(_window_size > _window_index);
+
+    // the valid spectrum always belongs to the full window, see the class comment
+    std::rotate(_window, _window + _window_index, _window + _window_size);
+
+    _window_index = 0;
+    return _window;
+}
+
+template<typename Float>
+sdft_Error FlatView<Float>::validate()
+{
+    const cplx *w = window();
+    for (size_t i = 0; i < _flat->window_size; ++i) {
+        if (!matches_signal_trait((enum sdft_SignalTraits) _flat->signal_traits, w[i])) {
+            return SDFT_SIGNAL_TRAIT_VIOLATION;
+        }
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+sdft_Error FlatView<Float>::push_next_sample(void *next_sample)
+{
+    const cplx ns = *(cplx *) next_sample;
+    if (!matches_signal_trait((enum sdft_SignalTraits) _flat->signal_traits, ns)) {
+        return SDFT_SIGNAL_TRAIT_VIOLATION;
+    }
+
+    // the indices are copied to locals, which keeps the loops free of accesses to the header
+    const size_t window_size = static_cast<size_t>(_flat->window_size);
+    size_t window_index = static_cast<size_t>(_flat->window_index);
+    if (_flat->kind == SDFT_FLAT_COMBINED) {
+        cplx *spectra[2] = {spectrum(0), spectrum(1)};
+        size_t clear_counter = static_cast<size_t>(_flat->clear_counter);
+        push_shared_combined(window(), spectra, phase_offsets(), window_size, get_number_of_bins(),
+                window_index, clear_counter, ns, _averaging);
+        _flat->clear_counter = clear_counter;
+    } else {
+        const cplx delta = advance_ring(window(), window_size, window_index, ns);
+        slide_dft_bins(spectrum(0), phase_offsets(), get_number_of_bins(), delta, _averaging);
+    }
+    _flat->window_index = window_index;
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+void *FlatView<Float>::unshift_and_get_window()
+{
+    cplx *w = window();
+    std::rotate(w, w + _flat->window_index, w + _flat->window_size);
+
+    _flat->window_index = 0;
+    return w;
+}
+
+template<typename Float>
+Paired<Float>::Paired(Impl<Float> *x, Impl<Float> *y, void *cross_spectrum, void *auto_spectra,
+        double time_constant)
+        : _x(x), _y(y), _cross_spectrum((cplx *) cross_spectrum), _auto_spectra((Float *) auto_spectra),
+          _time_constant(time_constant), _alpha(alpha_from_time_constant<Float>(time_constant))
+{
+    // start the averages at the initial spectra instead of at zero
+    _x->apply_pending_rotation();
+    _y->apply_pending_rotation();
+    size_t n_bins = _x->get_number_of_bins();
+    for (size_t i = 0; i < n_bins; ++i) {
+        const cplx &X = _x->_spectrum[i];
+        const cplx &Y = _y->_spectrum[i];
+        _auto_spectra[i] = std::norm(X);
+        _auto_spectra[n_bins + i] = std::norm(Y);
+        _cross_spectrum[i] = X * std::conj(Y);
+    }
+}
+
+template<typename Float>
+sdft_Error Paired<Float>::validate()
+{
+    // also catches NaN
+    if (!(_time_constant >= 0)) {
+        return SDFT_INVALID_TIME_CONSTANT;
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+sdft_Error Paired<Float>::push_next_sample(void *next_samples)
+{
+    cplx *ns = (cplx *) next_samples;
+
+    if (!_x->matches_signal_trait(ns[0]) || !_y->matches_signal_trait(ns[1])) {
+        return SDFT_SIGNAL_TRAIT_VIOLATION;
+    }
+
+    const cplx os_x = _x->_window[_x->_window_index];
+    const cplx os_y = _y->_window[_y->_window_index];
+    cplx delta_x = _x->advance_window(ns[0]);
+    cplx delta_y = _y->advance_window(ns[1]);
+
+    size_t n_bins = _x->get_number_of_bins();
+    cplx *spectrum_x = _x->_spectrum;
+    cplx *spectrum_y = _y->_spectrum;
+    // The phase offsets and corrections of both states are identical, so we only read those of _x.
+    const cplx *phase_offsets = _x->_phase_offsets;
+    const cplx *corrections = _x->_corrections;
+    Float *auto_x = _auto_spectra;
+    Float *auto_y = _auto_spectra + n_bins;
+    const Float alpha = _alpha;
+
+    for (size_t i = 0; i < n_bins; ++i) {
+        if (corrections != 0) {
+            delta_x = corrections[i] * ns[0] - os_x;
+            delta_y = corrections[i] * ns[1] - os_y;
+        }
+        const cplx X = (spectrum_x[i] + delta_x) * phase_offsets[i];
+        const cplx Y = (spectrum_y[i] + delta_y) * phase_offsets[i];
+        spectrum_x[i] = X;
+        spectrum_y[i] = Y;
+        auto_x[i] += alpha * (std::norm(X) - auto_x[i]);
+        auto_y[i] += alpha * (std::norm(Y) - auto_y[i]);
+        _cross_spectrum[i] += alpha * (X * std::conj(Y) - _cross_spectrum[i]);
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+void *Paired<Float>::unshift_and_get_window()
+{
+    _y->unshift_and_get_window();
+    return _x->unshift_and_get_window();
+}
+
+template<typename Float>
+sdft_Error Paired<Float>::get_coherence(void *coherence)
+{
+    Float *out = (Float *) coherence;
+    size_t n_bins = _x->get_number_of_bins();
+    for (size_t i = 0; i < n_bins; ++i) {
+        const Float denominator = _auto_spectra[i] * _auto_spectra[n_bins + i];
+        out[i] = denominator > 0 ? std::norm(_cross_spectrum[i]) / denominator : 0;
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+Cosine<Float>::Cosine(void *window, void *coefficients, void *twiddles, size_t window_size,
+        enum sdft_CosineKind kind)
+        : _window((Float *) window), _coefficients((cplx *) coefficients), _twiddles((cplx *) twiddles),
+          _window_index(0), _window_size(window_size), _kind(kind)
+{
+    // Coefficient k is sum_n x[n] * exp(i * omega_k * (n + 1/2)). Sliding the window by one sample turns it into
+    // exp(-i * omega_k) * (X_k + exp(i * omega_k / 2) * (exp(i * omega_k * N) * x_new - x_old)),
+    // where exp(i * omega_k * N) is (-1)^k for the DCT-II and i * (-1)^k for the DCT-IV. The weight of the samples is
+    // stored as exp(-i * omega_k / 2), i.e. with the rotation applied, see push_next_sample.
+    const long double offset = kind == SDFT_DCT_IV ? 0.5L : 0;
+    for (size_t k = 0; k < window_size; ++k) {
+        // omega_k / (2 * pi)
+        const long double cycles = (k + offset) / (2.0L * window_size);
+        _twiddles[k] = unit_phasor<Float>(-cycles);
+        _twiddles[window_size + k] = unit_phasor<Float>(-cycles / 2);
+    }
+}
+
+template<typename Float>
+sdft_Error Cosine<Float>::validate()
+{
+    // the window should be of at least length 1
+    if (_window_size < 1) {
+        return SDFT_WINDOW_TOO_SHORT;
+    }
+
+    if (_kind != SDFT_DCT_II && _kind != SDFT_DCT_IV) {
+        return SDFT_NOT_SUPPORTED;
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+void Cosine<Float>::clear()
+{
+    for (size_t i = 0; i < _window_size; ++i) {
+        _window[i] = 0;
+    }
+
+    for (size_t i = 0; i < _window_size; ++i) {
+        _coefficients[i] = 0;
+    }
+
+    _window_index = 0;
+}
+
+template<typename Float>
+sdft_Error Cosine<Float>::push_next_sample(void *next_sample)
+{
+    assert(_window_index < _window_size);
+
+    const Float ns = *(Float *) next_sample;
+    const Float os = _window[_window_index];
+
+    const cplx *rotations = _twiddles;
+    const cplx *weights = _twiddles + _window_size;
+
+    // The (cosine, sine) pair of coefficient k is rotated by the real 2x2 rotation (c, s) and the weighted samples
+    // are added in real arithmetic. The samples are real, so they only scale the (already rotated) weight (g, h).
+    if (_kind == SDFT_DCT_II) {
+        // the sign of the incoming sample alternates with k
+        const Float even_delta = ns - os;
+        const Float odd_delta = -ns - os;
+        for (size_t k = 0; k < _window_size; ++k) {
+            const Float delta = (k & 1) ? odd_delta : even_delta;
+            const Float re = _coefficients[k].real(), im = _coefficients[k].imag();
+            const Float c = rotations[k].real(), s = rotations[k].imag();
+            const Float g = weights[k].real(), h = weights[k].imag();
+            _coefficients[k] = cplx(re * c - im * s + delta * g, re * s + im * c + delta * h);
+        }
+    } else {
+        // the incoming sample is weighted by i * (-1)^k, i.e. by (-h, g) with alternating sign
+        for (size_t k = 0; k < _window_size; ++k) {
+            const Float in = (k & 1) ? -ns : ns;
+            const Float re = _coefficients[k].real(), im = _coefficients[k].imag();
+            const Float c = rotations[k].real(), s = rotations[k].imag();
+            const Float g = weights[k].real(), h = weights[k].imag();
+            _coefficients[k] = cplx(re * c - im * s - os * g - in * h, re * s + im * c - os * h + in * g);
+        }
+    }
+
+    _window[_window_index] = ns;
+    if (++_window_index == _window_size) {
+        _window_index = 0;
+    }
+
+    return SDFT_NO_ERROR;
+}
 
-    virtual enum sdft_Error combine_with(struct sdft_State *other, void *buffer) = 0;
+template<typename Float>
+void *Cosine<Float>::unshift_and_get_window()
+{
+    assert(_window_size > _window_index);
 
-    virtual ~sdft_State()
-    {
-    };
-};
+    // this cyclically shifts the element at _window_index to the front
+    std::rotate(_window, _window + _window_index, _window + _window_size);
 
-template<typename Float>
-struct Combined;
+    _window_index = 0;
+    return _window;
+}
 
 template<typename Float>
-struct Impl : public sdft_State {
-    Impl(void *signal, void *spectrum, void *phase_offsets, size_t window_size,
-            enum sdft_SignalTraits signal_traits);
-
-    sdft_Error validate();
+Goertzel<Float>::Goertzel(void *window, void *spectrum, void *coefficients, void *resonators, size_t window_size,
+        enum sdft_SignalTraits signal_traits, const double *bins, size_t n_bins)
+        : _window((cplx *) window), _spectrum((cplx *) spectrum), _phasors((cplx *) coefficients),
+          _cosines((Float *) (_phasors + 2 * n_bins)), _resonators((Float *) resonators), _window_index(0),
+          _window_size(window_size), _n_bins(n_bins), _integral(true), _restart(false), _finite(true),
+          _signal_traits(signal_traits)
+{
+    for (size_t k = 0; k < n_bins; ++k) {
+        if (!std::isfinite(bins[k])) {
+            _finite = false;
+            return;
+        }
+        _integral = _integral && bins[k] == std::floor(bins[k]);
+    }
 
-    void clear();
+    if (window_size < 1) {
+        return;
+    }
 
-    size_t get_window_size() const
-    {
-        return _window_size;
+    // bins at multiples of N/2, whose poles lie at 1 or -1
+    for (size_t k = 0; k < n_bins; ++k) {
+        _restart = _restart || std::fmod(2 * bins[k], static_cast<double>(window_size)) == 0;
+    }
+    _restart = _restart || !_integral;
+
+    for (size_t k = 0; k < n_bins; ++k) {
+        // omega_k / (2 * pi)
+        const long double cycles = bins[k] / window_size;
+        _phasors[k] = unit_phasor<Float>(cycles);
+        _phasors[n_bins + k] = unit_phasor<Float>(-static_cast<long double>(bins[k]));
+        _cosines[k] = 2 * std::real(_phasors[k]);
     }
 
-    sdft_Error push_next_sample(void *next_sample);
+    prime();
+}
 
-    void *get_spectrum()
-    {
-        return _spectrum;
+template<typename Float>
+sdft_Error Goertzel<Float>::validate()
+{
+    // the window should be of at least length 1
+    if (_window_size < 1) {
+        return SDFT_WINDOW_TOO_SHORT;
     }
 
-    void *unshift_and_get_window();
+    if (_n_bins < 1 || !_finite) {
+        return SDFT_INVALID_FREQUENCIES;
+    }
 
-    sdft_Error combine_with(struct sdft_State *other, void *buffer)
-    {
-        Impl<Float> *o = dynamic_cast<Impl<Float> *>(other);
-        if (o != 0 && o->_window_size == _window_size && o->_signal_traits == _signal_traits) {
-            new(buffer) Combined<Float>(this, o);
-            return SDFT_NO_ERROR;
+    // check for violations of the signal traits
+    for (size_t i = 0; i < _window_size; ++i) {
+        if (!matches_signal_trait(_signal_traits, _window[i])) {
+            return SDFT_SIGNAL_TRAIT_VIOLATION;
         }
-
-        return SDFT_NOT_COMBINABLE;
     }
 
-private:
-    typedef std::complex<Float> cplx;
-
-    bool matches_signal_trait(const cplx &c) const;
-
-    cplx *_window;
-    cplx *_spectrum;
-    cplx *_phase_offsets;
-    size_t _window_index;
-    size_t _window_size;
-    enum sdft_SignalTraits _signal_traits;
-};
+    return SDFT_NO_ERROR;
+}
 
 template<typename Float>
-struct Combined : public sdft_State {
-    Combined(Impl<Float> *first, Impl<Float> *second);
-
-    sdft_Error validate();
+void Goertzel<Float>::clear()
+{
+    for (size_t i = 0; i < _window_size; ++i) {
+        _window[i] = 0;
+    }
 
-    sdft_Error push_next_sample(void *next_sample);
+    std::fill(_resonators, _resonators + 4 * get_number_of_components() * _n_bins, Float(0));
 
-    void *unshift_and_get_window();
+    _window_index = 0;
+}
 
-    void *get_spectrum()
-    {
-        assert(_clear_counter <= 2 * _window_size);
-        // See the invariant in push_next_sample.
-        return _clear_counter <= _window_size
-                ? _first->get_spectrum()
-                : _second->get_spectrum();
-    }
+template<typename Float>
+void Goertzel<Float>::prime()
+{
+    assert(_window_index == 0);
 
-    enum sdft_Error combine_with(struct sdft_State *, void *)
-    {
-        return SDFT_NOT_COMBINABLE;
+    // Pushing the window into cleared resonators, during which the outgoing samples are all zero, yields the same
+    // spectrum as all the pushes before, but without the rounding errors they accumulated in the resonators.
+    std::fill(_resonators, _resonators + 4 * get_number_of_components() * _n_bins, Float(0));
+    for (size_t i = 0; i < _window_size; ++i) {
+        feed(0, _window[i]);
     }
+}
 
-private:
-    Impl<Float> *_first;
-    Impl<Float> *_second;
-    size_t _window_size;
-    size_t _clear_counter;
-};
-
-//
-// Implementations of exported functions
-//
-
-size_t sdft_size_of_state()
+template<typename Float>
+void Goertzel<Float>::resonate(size_t resonator, size_t component, Float input)
 {
-    return std::max(sizeof(struct Impl<long double>), sizeof(struct Combined<long double>));
+    Float *s = get_resonator(resonator, component, false);
+    Float *s_prev = get_resonator(resonator, component, true);
+    const Float *cosines = _cosines;
+
+    for (size_t k = 0; k < _n_bins; ++k) {
+        const Float next = input + cosines[k] * s[k] - s_prev[k];
+        s_prev[k] = s[k];
+        s[k] = next;
+    }
 }
 
-enum sdft_Error sdft_init_from_buffers(
-        struct sdft_State *s,
-        enum sdft_FloatPrecision precision,
-        void *window,
-        void *spectrum,
-        void *buffer,
-        size_t window_size,
-        enum sdft_SignalTraits signal_traits)
+template<typename Float>
+void Goertzel<Float>::feed(size_t resonator, typename Goertzel::cplx const &input)
 {
-
-    switch (precision) {
-        case SDFT_SINGLE:
-            new(s) Impl<float>(window, spectrum, buffer, window_size, signal_traits);
+    switch (_signal_traits) {
+        case SDFT_REAL_AND_IMAG:
+            resonate(resonator, 0, std::real(input));
+            resonate(resonator, 1, std::imag(input));
             break;
-        case SDFT_DOUBLE:
-            new(s) Impl<double>(window, spectrum, buffer, window_size, signal_traits);
+        case SDFT_REAL_ONLY:
+            resonate(resonator, 0, std::real(input));
             break;
-        case SDFT_LONG_DOUBLE:
-            new(s) Impl<long double>(window, spectrum, buffer, window_size, signal_traits);
+        case SDFT_IMAG_ONLY:
+            resonate(resonator, 0, std::imag(input));
             break;
     }
-
-    return s->validate();
 }
 
-enum sdft_Error sdft_init_combine(struct sdft_State *state, struct sdft_State *first, struct sdft_State *second)
+template<typename Float>
+sdft_Error Goertzel<Float>::push_next_sample(void *next_sample)
 {
-    sdft_Error err = first->combine_with(second, state);
-    if (err != SDFT_NO_ERROR) {
-        return err;
+    assert(_window_index < _window_size);
+
+    cplx ns = *(cplx *) next_sample;
+
+    if (!matches_signal_trait(_signal_traits, ns)) {
+        return SDFT_SIGNAL_TRAIT_VIOLATION;
     }
 
-    return state->validate();
-}
+    const cplx os = _window[_window_index];
+    if (_integral) {
+        feed(0, ns - os);
+    } else {
+        feed(0, ns);
+        feed(1, os);
+    }
 
-enum sdft_Error sdft_push_next_sample(struct sdft_State *s, void *next_sample)
-{
-    return s->push_next_sample(next_sample);
-}
+    _window[_window_index] = ns;
+    if (++_window_index == _window_size) {
+        _window_index = 0;
+        if (_restart) {
+            prime();
+        }
+    }
 
-void *sdft_get_spectrum(struct sdft_State *s)
-{
-    return s->get_spectrum();
+    return SDFT_NO_ERROR;
 }
 
-void *sdft_unshift_and_get_window(struct sdft_State *s)
+template<typename Float>
+void *Goertzel<Float>::get_spectrum()
 {
-    return s->unshift_and_get_window();
-}
+    const size_t n_resonators = _integral ? 1 : 2;
+    for (size_t k = 0; k < _n_bins; ++k) {
+        const cplx w = _phasors[k];
+        cplx y[2];
+        for (size_t r = 0; r < n_resonators; ++r) {
+            cplx s, s_prev;
+            switch (_signal_traits) {
+                case SDFT_REAL_AND_IMAG:
+                    s = cplx(get_resonator(r, 0, false)[k], get_resonator(r, 1, false)[k]);
+                    s_prev = cplx(get_resonator(r, 0, true)[k], get_resonator(r, 1, true)[k]);
+                    break;
+                case SDFT_REAL_ONLY:
+                    s = cplx(get_resonator(r, 0, false)[k], 0);
+                    s_prev = cplx(get_resonator(r, 0, true)[k], 0);
+                    break;
+                case SDFT_IMAG_ONLY:
+                    s = cplx(0, get_resonator(r, 0, false)[k]);
+                    s_prev = cplx(0, get_resonator(r, 0, true)[k]);
+                    break;
+            }
+            y[r] = s - std::conj(w) * s_prev;
+        }
 
-//
-// Templated implementations of the precision dependent functions
-//
+        _spectrum[k] = _integral
+                ? w * y[0]
+                : w * (_phasors[_n_bins + k] * y[0] - y[1]);
+    }
+
+    return _spectrum;
+}
 
 template<typename Float>
-Impl<Float>::Impl(void *signal, void *spectrum, void *phase_offsets,
-        size_t window_size, enum sdft_SignalTraits signal_traits)
-        : _window((cplx *) signal), _spectrum((cplx *) spectrum), _phase_offsets((cplx *) phase_offsets),
-          _window_index(0), _window_size(window_size), _signal_traits(signal_traits)
+void *Goertzel<Float>::unshift_and_get_window()
 {
-    // generate the phase offsets
-    const Float double_pi = static_cast<Float>(2 * 3.141592653589793238462643383279502884); // Enough precision for everyone!
-    for (size_t i = 0; i < window_size; i++) {
-        cplx angle(0, double_pi * i / window_size);
-        _phase_offsets[i] = std::exp(angle);
-    };
+    assert(_window_size > _window_index);
+
+    // this cyclically shifts the element at _window_index to the front
+    std::rotate(_window, _window + _window_index, _window + _window_size);
+
+    _window_index = 0;
+    return _window;
 }
 
 template<typename Float>
-bool Impl<Float>::matches_signal_trait(typename Impl::cplx const &c) const
+ConstantQ<Float>::ConstantQ(void *window, void *spectrum, void *coefficients, size_t *lengths, size_t window_size,
+        enum sdft_SignalTraits signal_traits, double min_frequency, size_t bins_per_octave, size_t n_bins)
+        : _window((cplx *) window), _spectrum((cplx *) spectrum), _phase_offsets((cplx *) coefficients),
+          _lengths(lengths), _window_index(0), _window_size(window_size), _n_bins(n_bins),
+          _min_frequency(min_frequency), _bins_per_octave(bins_per_octave),
+          _valid_frequencies(valid_constant_q_parameters(min_frequency, bins_per_octave)),
+          _required_window_size(sdft_constant_q_window_size(min_frequency, bins_per_octave)),
+          _signal_traits(signal_traits)
 {
-    return _signal_traits == SDFT_REAL_AND_IMAG
-            || (_signal_traits == SDFT_REAL_ONLY && std::imag(c) == 0)
-            || (_signal_traits == SDFT_IMAG_ONLY && std::real(c) == 0);
+    if (!_valid_frequencies || window_size < _required_window_size) {
+        return;
+    }
+
+    for (size_t k = 0; k < n_bins; ++k) {
+        const long double frequency = min_frequency * std::pow(2.0L, static_cast<long double>(k) / bins_per_octave);
+        _lengths[k] = constant_q_length(static_cast<double>(frequency), bins_per_octave);
+        _phase_offsets[k] = unit_phasor<Float>(frequency);
+        _phase_offsets[n_bins + k] = unit_phasor<Float>(-frequency * _lengths[k]);
+
+        // compute the initial spectrum from the last _lengths[k] samples of the window
+        const size_t offset = window_size - _lengths[k];
+        _spectrum[k] = 0;
+        for (size_t j = 0; j < _lengths[k]; ++j) {
+            _spectrum[k] += _window[offset + j] * unit_phasor<Float>(-frequency * j);
+        }
+    }
 }
 
 template<typename Float>
-sdft_Error Impl<Float>::validate()
+sdft_Error ConstantQ<Float>::validate()
 {
-    // the window should be of at least length 1
-    if (_window_size < 1) {
+    if (!_valid_frequencies || _n_bins < 1) {
+        return SDFT_INVALID_FREQUENCIES;
+    }
+
+    // the window has to hold the longest bin
+    if (_window_size < 1 || _window_size < _required_window_size) {
         return SDFT_WINDOW_TOO_SHORT;
     }
 
     // check for violations of the signal traits
     for (size_t i = 0; i < _window_size; ++i) {
-        if (!matches_signal_trait(_window[i])) {
+        if (!matches_signal_trait(_signal_traits, _window[i])) {
             return SDFT_SIGNAL_TRAIT_VIOLATION;
         }
     }
@@ -210,13 +3045,13 @@ sdft_Error Impl<Float>::validate()
 }
 
 template<typename Float>
-void Impl<Float>::clear()
+void ConstantQ<Float>::clear()
 {
     for (size_t i = 0; i < _window_size; ++i) {
         _window[i] = 0;
     }
 
-    for (size_t i = 0; i < _window_size; ++i) {
+    for (size_t i = 0; i < _n_bins; ++i) {
         _spectrum[i] = 0;
     }
 
@@ -224,24 +3059,26 @@ void Impl<Float>::clear()
 }
 
 template<typename Float>
-sdft_Error Impl<Float>::push_next_sample(void *next_sample)
+sdft_Error ConstantQ<Float>::push_next_sample(void *next_sample)
 {
-    assert(_window_index >= 0 && _window_index < _window_size);
+    assert(_window_index < _window_size);
 
     cplx ns = *(cplx *) next_sample;
 
-    if (!matches_signal_trait(ns)) {
+    if (!matches_signal_trait(_signal_traits, ns)) {
         return SDFT_SIGNAL_TRAIT_VIOLATION;
     }
 
-    cplx delta = ns - _window[_window_index];
-
-    size_t n_bins = _signal_traits == SDFT_REAL_AND_IMAG
-            ? _window_size
-            : _window_size / 2; // only first half of spectrum relevant
-
-    for (size_t i = 0; i < n_bins; ++i) {
-        _spectrum[i] = (_spectrum[i] + delta) * _phase_offsets[i];
+    const cplx *phase_offsets = _phase_offsets;
+    const cplx *corrections = _phase_offsets + _n_bins;
+    // _window_index + _window_size - _lengths[k] is the position of the sample pushed _lengths[k] samples ago,
+    // which has not yet been overwritten by ns
+    for (size_t k = 0; k < _n_bins; ++k) {
+        size_t position = _window_index + _window_size - _lengths[k];
+        if (position >= _window_size) {
+            position -= _window_size;
+        }
+        _spectrum[k] = (_spectrum[k] + corrections[k] * ns - _window[position]) * phase_offsets[k];
     }
 
     _window[_window_index] = ns;
@@ -253,7 +3090,7 @@ sdft_Error Impl<Float>::push_next_sample(void *next_sample)
 }
 
 template<typename Float>
-void *Impl<Float>::unshift_and_get_window()
+void *ConstantQ<Float>::unshift_and_get_window()
 {
     assert(_window_size > _window_index);
 
@@ -265,55 +3102,145 @@ void *Impl<Float>::unshift_and_get_window()
 }
 
 template<typename Float>
-Combined<Float>::Combined(Impl<Float> *first, Impl<Float> *second)
-        : _first(first), _second(second), _window_size(first->get_window_size()), _clear_counter(0)
+Decimating<Float>::Decimating(TypedState<Float> *inner, size_t factor, size_t taps_per_phase, void *taps,
+        void *history, double center_frequency)
+        : _inner(inner), _center_frequency(center_frequency), _oscillator(1), _oscillator_step(1),
+          _taps((Float *) taps), _history((cplx *) history), _factor(factor), _n_taps(factor * taps_per_phase),
+          _history_index(0), _phase(0)
 {
-    _second->clear();
+    if (_n_taps < 1 || !std::isfinite(center_frequency)) {
+        return;
+    }
+
+    _oscillator_step = unit_phasor<Float>(-static_cast<long double>(center_frequency));
+
+    // Blackman windowed sinc with cutoff 0.5 / factor, which is symmetric and thus needs not be reversed
+    const long double pi = 3.141592653589793238462643383279502884L;
+    const long double cutoff = 0.5L / factor;
+    const long double center = (_n_taps - 1) / 2.0L;
+    long double sum = 0;
+    for (size_t j = 0; j < _n_taps; ++j) {
+        const long double t = j - center;
+        const long double sinc = t == 0 ? 2 * cutoff : std::sin(2 * pi * cutoff * t) / (pi * t);
+        const long double phase = _n_taps > 1 ? 2 * pi * j / (_n_taps - 1) : 0;
+        const long double window = 0.42L - 0.5L * std::cos(phase) + 0.08L * std::cos(2 * phase);
+        _taps[j] = static_cast<Float>(sinc * window);
+        sum += _taps[j];
+    }
+
+    for (size_t j = 0; j < _n_taps; ++j) {
+        _taps[j] = static_cast<Float>(_taps[j] / sum);
+    }
+
+    std::fill(_history, _history + 2 * _n_taps, cplx(0));
 }
 
 template<typename Float>
-sdft_Error Combined<Float>::validate()
+sdft_Error Decimating<Float>::validate()
 {
+    if (_n_taps < 1) {
+        return SDFT_INVALID_FILTER;
+    }
+
+    if (!std::isfinite(_center_frequency)) {
+        return SDFT_INVALID_FREQUENCIES;
+    }
+
+    // Paired states expect two samples per push
+    if (dynamic_cast<Paired<Float> *>(_inner) != 0) {
+        return SDFT_NOT_SUPPORTED;
+    }
+
+    // Mixing down makes the signal complex, which inner has to take as a whole, so neither states with real or
+    // imaginary signal traits nor cosine states, which take real samples.
+    const cplx complex_sample(1, 1);
+    if (_center_frequency != 0 && (_inner->get_sample_size() != sizeof(cplx)
+            || _inner->check_samples(&complex_sample, 1) != SDFT_NO_ERROR)) {
+        return SDFT_NOT_SUPPORTED;
+    }
+
     return SDFT_NO_ERROR;
 }
 
 template<typename Float>
-sdft_Error Combined<Float>::push_next_sample(void *next_sample)
+sdft_Error Decimating<Float>::push_next_sample(void *next_sample)
 {
-    // Invariant: 0 <= _clear_counter <= _window_size
-    //                  iff _first has the valid spectrum
-    //            _window_size < _clear_counter <= 2*_window_size
-    //                  iff _second has the valid spectrum
-    assert(_clear_counter <= 2 * _window_size);
+    // a violating sample would otherwise enter the history and make the pushes of the next outputs into inner fail
+    enum sdft_Error err = check_samples(next_sample, 1);
+    if (err != SDFT_NO_ERROR) {
+        return err;
+    }
 
-    if (_clear_counter == _window_size) {
-        _first->clear();
-    } else if (_clear_counter == 2 * _window_size) {
-        _second->clear();
-        _clear_counter = 0;
+    const cplx ns = *(cplx *) next_sample * _oscillator;
+    _oscillator *= _oscillator_step;
+
+    _history[_history_index] = ns;
+    _history[_history_index + _n_taps] = ns;
+    if (++_history_index == _n_taps) {
+        _history_index = 0;
     }
 
-    enum sdft_Error err = _first->push_next_sample(next_sample);
-    if (err != SDFT_NO_ERROR) {
-        return err;
+    if (++_phase < _factor) {
+        return SDFT_NO_ERROR;
     }
+    _phase = 0;
 
-    err = _second->push_next_sample(next_sample);
-    if (err != SDFT_NO_ERROR) {
-        return err;
+    // pull the magnitude of the oscillator back to 1, which the repeated rotations slowly drift away from
+    _oscillator *= Float(1.5) - Float(0.5) * std::norm(_oscillator);
+
+    // the last _n_taps samples in temporal order
+    const cplx *samples = _history + _history_index;
+    cplx filtered = 0;
+    for (size_t j = 0; j < _n_taps; ++j) {
+        filtered += _taps[j] * samples[j];
     }
 
-    _clear_counter++;
+    return _inner->push_next_sample(&filtered);
+}
+
+template<typename Float>
+Leaky<Float>::Leaky(void *spectrum, void *poles, size_t window_size, enum sdft_SignalTraits signal_traits,
+        double time_constant)
+        : _spectrum((cplx *) spectrum), _poles((cplx *) poles), _window_size(window_size),
+          _signal_traits(signal_traits), _time_constant(time_constant)
+{
+    if (validate() != SDFT_NO_ERROR) {
+        return;
+    }
+
+    const long double lambda = std::exp(-1 / static_cast<long double>(time_constant));
+    for (size_t k = 0; k < get_number_of_bins(); ++k) {
+        _poles[k] = unit_phasor<Float>(static_cast<long double>(k) / window_size) * static_cast<Float>(lambda);
+        _spectrum[k] = 0;
+    }
+}
+
+template<typename Float>
+sdft_Error Leaky<Float>::validate()
+{
+    // the window should be of at least length 1
+    if (_window_size < 1) {
+        return SDFT_WINDOW_TOO_SHORT;
+    }
+
+    // also catches NaN, an infinite time constant would make the poles lossless
+    if (!(_time_constant > 0) || !std::isfinite(_time_constant)) {
+        return SDFT_INVALID_TIME_CONSTANT;
+    }
 
     return SDFT_NO_ERROR;
 }
 
 template<typename Float>
-void *Combined<Float>::unshift_and_get_window()
+sdft_Error Leaky<Float>::push_next_sample(void *next_sample)
 {
-    assert(_clear_counter <= 2 * _window_size);
-    // See the invariant in push_next_sample.
-    return _clear_counter <= _window_size
-            ? _first->unshift_and_get_window()
-            : _second->unshift_and_get_window();
+    const cplx ns = *(cplx *) next_sample;
+    if (!matches_signal_trait(_signal_traits, ns)) {
+        return SDFT_SIGNAL_TRAIT_VIOLATION;
+    }
+
+    // there is no outgoing sample, the decay of the poles forgets it instead
+    slide_dft_bins(_spectrum, _poles, get_number_of_bins(), ns, _averaging);
+
+    return SDFT_NO_ERROR;
 }
@@ -0,0 +1,434 @@
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+#include <complex>
+#include <limits>
+
+#include "sdft/sdft_pipeline.h"
+
+//
+// Internal pipeline struct. The outputs and filter memories of the stages live in the user supplied buffer, in
+// the order of the stages, see get_stage_buffer_size.
+//
+
+struct sdft_Pipeline {
+    struct sdft_State *state;
+    enum sdft_SampleFormat format;
+    size_t n_channels;
+    size_t channel;
+    const struct sdft_Stage *stages;
+    size_t n_stages;
+    // the index of the SDFT_STAGE_TRANSFORM stage
+    size_t transform;
+    size_t n_bins;
+    size_t hop_size;
+    size_t hop_counter;
+    unsigned long long n_samples;
+    const sdft_Sink *sinks;
+    void *const *sink_data;
+    double *buffer;
+};
+
+// Returns the number of doubles stage needs in the buffer of the pipeline.
+static size_t get_stage_buffer_size(const struct sdft_Stage &stage, size_t n_bins)
+{
+    switch (stage.kind) {
+        case SDFT_STAGE_DC_REMOVAL:
+            // the previous input and output
+            return 2;
+        case SDFT_STAGE_POWER:
+            return n_bins;
+        case SDFT_STAGE_BANDS:
+            return stage.n_band_edges - 1;
+        default:
+            return 0;
+    }
+}
+
+static bool is_conditioning(enum sdft_StageKind kind)
+{
+    return kind == SDFT_STAGE_GAIN || kind == SDFT_STAGE_DC_REMOVAL;
+}
+
+//
+// Sample decoding, scaled to [-1, 1) for integers
+//
+
+static double decode(short sample)
+{
+    return sample / 32768.0;
+}
+
+static double decode(int sample)
+{
+    return sample / 2147483648.0;
+}
+
+static double decode(float sample)
+{
+    return sample;
+}
+
+static double decode(double sample)
+{
+    return sample;
+}
+
+//
+// The batch loop, templated on the sample type and the floating point type of the state
+//
+
+// Runs the reducers and sinks on the current spectrum of the state.
+template<typename Float>
+static void run_reducers(struct sdft_Pipeline *p, double *buffer)
+{
+    // the output of the previous stage, complex numbers for the spectrum and doubles otherwise
+    const void *data = sdft_get_spectrum(p->state);
+    size_t n_elements = p->n_bins;
+    bool is_spectrum = true;
+
+    for (size_t i = p->transform + 1; i < p->n_stages; ++i) {
+        const struct sdft_Stage &stage = p->stages[i];
+        switch (stage.kind) {
+            case SDFT_STAGE_POWER: {
+                assert(is_spectrum);
+                const std::complex<Float> *spectrum = (const std::complex<Float> *) data;
+                for (size_t k = 0; k < n_elements; ++k) {
+                    buffer[k] = static_cast<double>(std::norm(spectrum[k]));
+                }
+                data = buffer;
+                is_spectrum = false;
+                break;
+            }
+            case SDFT_STAGE_BANDS: {
+                const std::complex<Float> *spectrum = (const std::complex<Float> *) data;
+                const double *power = (const double *) data;
+                for (size_t b = 0; b + 1 < stage.n_band_edges; ++b) {
+                    double sum = 0;
+                    for (size_t k = stage.band_edges[b]; k < stage.band_edges[b + 1]; ++k) {
+                        sum += is_spectrum ? static_cast<double>(std::norm(spectrum[k])) : power[k];
+                    }
+                    buffer[b] = sum;
+                }
+                data = buffer;
+                n_elements = stage.n_band_edges - 1;
+                is_spectrum = false;
+                break;
+            }
+            case SDFT_STAGE_SINK: {
+                size_t sink = static_cast<size_t>(stage.parameter);
+                p->sinks[sink](p->sink_data[sink], data, n_elements, p->n_samples);
+                break;
+            }
+            default:
+                break;
+        }
+        buffer += get_stage_buffer_size(stage, p->n_bins);
+    }
+}
+
+// The frames need not be aligned for Sample, e.g. when they follow a WAV header, so samples are copied out.
+template<typename Float, typename Sample>
+static sdft_Error process(struct sdft_Pipeline *p, const unsigned char *frames, size_t n_frames)
+{
+    for (size_t f = 0; f < n_frames; ++f) {
+        Sample sample;
+        std::memcpy(&sample, frames + (f * p->n_channels + p->channel) * sizeof(Sample), sizeof(Sample));
+        double x = decode(sample);
+
+        double *buffer = p->buffer;
+        for (size_t i = 0; i < p->transform; ++i) {
+            const struct sdft_Stage &stage = p->stages[i];
+            if (stage.kind == SDFT_STAGE_GAIN) {
+                x *= stage.parameter;
+            } else {
+                // buffer[0] is the previous input, buffer[1] the previous output
+                const double y = x - buffer[0] + stage.parameter * buffer[1];
+                buffer[0] = x;
+                buffer[1] = y;
+                x = y;
+            }
+            buffer += get_stage_buffer_size(stage, p->n_bins);
+        }
+
+        std::complex<Float> next_sample(static_cast<Float>(x), 0);
+        sdft_Error err = sdft_push_next_sample(p->state, &next_sample);
+        if (err != SDFT_NO_ERROR) {
+            return err;
+        }
+        p->n_samples++;
+
+        if (++p->hop_counter == p->hop_size) {
+            p->hop_counter = 0;
+            run_reducers<Float>(p, buffer);
+        }
+    }
+
+    return SDFT_NO_ERROR;
+}
+
+template<typename Float>
+static sdft_Error process(struct sdft_Pipeline *p, const void *frames, size_t n_frames)
+{
+    const unsigned char *bytes = (const unsigned char *) frames;
+    switch (p->format) {
+        case SDFT_PCM_S16:
+            return process<Float, short>(p, bytes, n_frames);
+        case SDFT_PCM_S32:
+            return process<Float, int>(p, bytes, n_frames);
+        case SDFT_PCM_F32:
+            return process<Float, float>(p, bytes, n_frames);
+        case SDFT_PCM_F64:
+            return process<Float, double>(p, bytes, n_frames);
+    }
+
+    return SDFT_INVALID_PIPELINE;
+}
+
+// Returns whether value is finite, non-negative and small enough to be converted to a size_t.
+static bool is_size(double value)
+{
+    return std::isfinite(value) && value >= 0 && value < static_cast<double>(std::numeric_limits<size_t>::max());
+}
+
+// Returns whether state takes the real samples the pipeline pushes.
+template<typename Float>
+static bool takes_real_samples(struct sdft_State *state)
+{
+    const std::complex<Float> sample(1, 0);
+    return sdft_check_samples(state, &sample, 1) == SDFT_NO_ERROR;
+}
+
+// Returns the size of a complex number of the given precision.
+static size_t complex_size(enum sdft_FloatPrecision precision)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            return sizeof(std::complex<float>);
+        case SDFT_DOUBLE:
+            return sizeof(std::complex<double>);
+        default:
+            return sizeof(std::complex<long double>);
+    }
+}
+
+//
+// Implementations of exported functions
+//
+
+size_t sdft_size_of_pipeline()
+{
+    return sizeof(struct sdft_Pipeline);
+}
+
+enum sdft_Error sdft_parse_pipeline(
+        const char *config,
+        struct sdft_Stage *stages,
+        size_t max_stages,
+        size_t *n_stages)
+{
+    static const struct {
+        const char *name;
+        enum sdft_StageKind kind;
+        // the number of parameters, or -1 for a list of band edges
+        int n_parameters;
+    } names[] = {
+            {"gain",  SDFT_STAGE_GAIN,       1},
+            {"dc",    SDFT_STAGE_DC_REMOVAL, 1},
+            {"sdft",  SDFT_STAGE_TRANSFORM,  1},
+            {"power", SDFT_STAGE_POWER,      0},
+            {"bands", SDFT_STAGE_BANDS,      -1},
+            {"sink",  SDFT_STAGE_SINK,       1},
+    };
+
+    *n_stages = 0;
+    const char *c = config;
+    while (true) {
+        if (*n_stages == max_stages) {
+            return SDFT_INVALID_PIPELINE;
+        }
+        struct sdft_Stage &stage = stages[*n_stages];
+        stage.parameter = 0;
+        stage.n_band_edges = 0;
+
+        while (std::isspace((unsigned char) *c)) {
+            ++c;
+        }
+        const char *name = c;
+        while (std::isalpha((unsigned char) *c)) {
+            ++c;
+        }
+
+        size_t n = 0;
+        while (n < sizeof(names) / sizeof(names[0])
+                && (std::strlen(names[n].name) != size_t(c - name) || std::strncmp(names[n].name, name, c - name))) {
+            ++n;
+        }
+        if (n == sizeof(names) / sizeof(names[0])) {
+            return SDFT_INVALID_PIPELINE;
+        }
+        stage.kind = names[n].kind;
+
+        // parse the numbers up to the next '|' or the end
+        int n_parameters = 0;
+        while (true) {
+            char *end;
+            double value = std::strtod(c, &end);
+            if (end == c) {
+                break;
+            }
+            c = end;
+            if (names[n].n_parameters < 0) {
+                if (stage.n_band_edges == SDFT_MAX_BAND_EDGES || !is_size(value)) {
+                    return SDFT_INVALID_PIPELINE;
+                }
+                stage.band_edges[stage.n_band_edges++] = static_cast<size_t>(value);
+            } else {
+                stage.parameter = value;
+            }
+            n_parameters++;
+        }
+        if (names[n].n_parameters >= 0 && n_parameters != names[n].n_parameters) {
+            return SDFT_INVALID_PIPELINE;
+        }
+        ++*n_stages;
+
+        while (std::isspace((unsigned char) *c)) {
+            ++c;
+        }
+        if (*c == '\0') {
+            return SDFT_NO_ERROR;
+        }
+        if (*c++ != '|') {
+            return SDFT_INVALID_PIPELINE;
+        }
+    }
+}
+
+size_t sdft_pipeline_buffer_size(struct sdft_State *state, const struct sdft_Stage *stages, size_t n_stages)
+{
+    size_t n_bins = sdft_get_number_of_bins(state);
+    size_t size = 0;
+    for (size_t i = 0; i < n_stages; ++i) {
+        size += get_stage_buffer_size(stages[i], n_bins);
+    }
+
+    return size * sizeof(double);
+}
+
+enum sdft_Error sdft_init_pipeline(
+        struct sdft_Pipeline *p,
+        struct sdft_State *state,
+        enum sdft_SampleFormat format,
+        size_t n_channels,
+        size_t channel,
+        const struct sdft_Stage *stages,
+        size_t n_stages,
+        const sdft_Sink *sinks,
+        void *const *sink_data,
+        size_t n_sinks,
+        void *buffer)
+{
+    p->state = state;
+    p->format = format;
+    p->n_channels = n_channels;
+    p->channel = channel;
+    p->stages = stages;
+    p->n_stages = n_stages;
+    p->n_bins = sdft_get_number_of_bins(state);
+    p->hop_counter = 0;
+    p->n_samples = 0;
+    p->sinks = sinks;
+    p->sink_data = sink_data;
+    p->buffer = (double *) buffer;
+
+    if (channel >= n_channels) {
+        return SDFT_INVALID_PIPELINE;
+    }
+
+    // the samples are pushed as single complex numbers, of which cosine states only read the real part
+    if (sdft_get_sample_size(state) > complex_size(sdft_get_precision(state))) {
+        return SDFT_NOT_SUPPORTED;
+    }
+
+    // the decoded samples are real, which e.g. states of purely imaginary signals reject on every push
+    const bool takes_real = sdft_get_precision(state) == SDFT_SINGLE ? takes_real_samples<float>(state)
+            : sdft_get_precision(state) == SDFT_DOUBLE ? takes_real_samples<double>(state)
+            : takes_real_samples<long double>(state);
+    if (!takes_real) {
+        return SDFT_NOT_SUPPORTED;
+    }
+
+    // conditioning stages up to the transform, whose parameters must keep the samples finite and the DC removal stable
+    p->transform = 0;
+    while (p->transform < n_stages && is_conditioning(stages[p->transform].kind)) {
+        const struct sdft_Stage &stage = stages[p->transform];
+        if (!std::isfinite(stage.parameter)
+                || (stage.kind == SDFT_STAGE_DC_REMOVAL && !(std::fabs(stage.parameter) < 1))) {
+            return SDFT_INVALID_PIPELINE;
+        }
+        p->transform++;
+    }
+    if (p->transform == n_stages || stages[p->transform].kind != SDFT_STAGE_TRANSFORM) {
+        return SDFT_INVALID_PIPELINE;
+    }
+    if (!is_size(stages[p->transform].parameter) || stages[p->transform].parameter < 1) {
+        return SDFT_INVALID_HOP_SIZE;
+    }
+    p->hop_size = static_cast<size_t>(stages[p->transform].parameter);
+
+    // reducers and sinks after it, which consume n_elements elements of the previous output
+    bool is_spectrum = true;
+    size_t n_elements = p->n_bins;
+    for (size_t i = p->transform + 1; i < n_stages; ++i) {
+        const struct sdft_Stage &stage = stages[i];
+        switch (stage.kind) {
+            case SDFT_STAGE_POWER:
+                if (!is_spectrum) {
+                    return SDFT_INVALID_PIPELINE;
+                }
+                is_spectrum = false;
+                break;
+            case SDFT_STAGE_BANDS:
+                if (stage.n_band_edges < 2) {
+                    return SDFT_INVALID_PIPELINE;
+                }
+                for (size_t b = 0; b < stage.n_band_edges; ++b) {
+                    if (stage.band_edges[b] > n_elements || (b > 0 && stage.band_edges[b] < stage.band_edges[b - 1])) {
+                        return SDFT_INVALID_PIPELINE;
+                    }
+                }
+                is_spectrum = false;
+                n_elements = stage.n_band_edges - 1;
+                break;
+            case SDFT_STAGE_SINK:
+                if (!(stage.parameter >= 0) || stage.parameter >= n_sinks) {
+                    return SDFT_INVALID_PIPELINE;
+                }
+                break;
+            default:
+                return SDFT_INVALID_PIPELINE;
+        }
+    }
+
+    std::memset(buffer, 0, sdft_pipeline_buffer_size(state, stages, n_stages));
+
+    return SDFT_NO_ERROR;
+}
+
+enum sdft_Error sdft_pipeline_process(struct sdft_Pipeline *p, const void *frames, size_t n_frames)
+{
+    switch (sdft_get_precision(p->state)) {
+        case SDFT_SINGLE:
+            return process<float>(p, frames, n_frames);
+        case SDFT_DOUBLE:
+            return process<double>(p, frames, n_frames);
+        case SDFT_LONG_DOUBLE:
+            return process<long double>(p, frames, n_frames);
+    }
+
+    return SDFT_INVALID_PIPELINE;
+}
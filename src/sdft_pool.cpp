@@ -0,0 +1,343 @@
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // memfd_create
+#endif
+
+#include <cerrno>
+#include <cstring>
+
+#include <atomic>
+#include <limits>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "sdft/sdft_pool.h"
+
+//
+// Layout of the shared memory object: the pool header, followed by n_states slots of slot_size bytes. Each slot
+// starts with the sequence counter of its state, followed by the flat state at the next cache line.
+//
+
+namespace {
+
+const uint32_t pool_magic = 0x4C4F4F50u; // "POOL"
+
+const size_t cache_line = 64;
+
+struct PoolHeader {
+    uint32_t magic;
+    uint32_t reserved;
+    uint64_t n_states;
+    uint64_t slot_size;
+    uint64_t size;
+};
+
+// The sequence counter is odd while the writer writes the state. Lock-free atomics are address-free, so they work
+// across processes which map the same memory.
+typedef std::atomic<unsigned long long> Sequence;
+
+size_t align(size_t offset)
+{
+    return (offset + cache_line - 1) / cache_line * cache_line;
+}
+
+size_t slots_offset()
+{
+    return align(sizeof(PoolHeader));
+}
+
+}
+
+struct sdft_Pool {
+    char *base;
+    size_t size;
+    int fd;
+    size_t n_states;
+    size_t slot_size;
+};
+
+static Sequence *sequence(const struct sdft_Pool *p, size_t index)
+{
+    return (Sequence *) (p->base + slots_offset() + index * p->slot_size);
+}
+
+static void reset(struct sdft_Pool *p)
+{
+    p->base = 0;
+    p->size = 0;
+    p->fd = -1;
+    p->n_states = 0;
+    p->slot_size = 0;
+}
+
+// Fails with SDFT_SYSTEM_ERROR, preserving errno over the clean-up.
+static sdft_Error system_error(struct sdft_Pool *p)
+{
+    int err = errno;
+    sdft_pool_close(p);
+    errno = err;
+    return SDFT_SYSTEM_ERROR;
+}
+
+#ifdef __linux__
+// Seals the anonymous shared memory object fd against resizing and, where the kernel supports it (Linux 5.1), against
+// new writable mappings, so that processes which receive the descriptor can neither make the writer fault nor alter
+// the states behind its back.
+static int seal(int fd)
+{
+    const int seals = F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL;
+#ifdef F_SEAL_FUTURE_WRITE
+    if (fcntl(fd, F_ADD_SEALS, seals | F_SEAL_FUTURE_WRITE) == 0) {
+        return 0;
+    }
+#endif
+    return fcntl(fd, F_ADD_SEALS, seals);
+}
+#endif
+
+// Like system_error, but also removes the shared memory object name which the failed call has created.
+static sdft_Error created_error(struct sdft_Pool *p, const char *name)
+{
+    int err = errno;
+    if (name != 0) {
+        shm_unlink(name);
+    }
+    errno = err;
+    return system_error(p);
+}
+
+//
+// Implementations of exported functions
+//
+
+size_t sdft_size_of_pool()
+{
+    return sizeof(struct sdft_Pool);
+}
+
+enum sdft_Error sdft_pool_create(
+        struct sdft_Pool *p,
+        const char *name,
+        size_t n_states,
+        enum sdft_FloatPrecision precision,
+        size_t window_size,
+        enum sdft_SignalTraits signal_traits,
+        enum sdft_FlatKind kind)
+{
+    static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "the sequence counters have to be address-free");
+
+    reset(p);
+    if (window_size < 1) {
+        return SDFT_WINDOW_TOO_SHORT;
+    }
+
+    // the same error as sdft_init_flat for windows whose state would not be addressable
+    const size_t flat_size = sdft_flat_size(precision, window_size, kind);
+    if (flat_size == 0) {
+        return SDFT_NOT_SUPPORTED;
+    }
+
+    const size_t max_size = static_cast<size_t>(std::numeric_limits<off_t>::max());
+    if (flat_size > max_size - slots_offset() - 2 * cache_line) {
+        errno = EOVERFLOW;
+        return SDFT_SYSTEM_ERROR;
+    }
+    const size_t slot_size = align(cache_line + flat_size);
+    if (n_states > (max_size - slots_offset()) / slot_size) {
+        errno = EOVERFLOW;
+        return SDFT_SYSTEM_ERROR;
+    }
+
+    if (name != 0) {
+        p->fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, 0644);
+    } else {
+#ifdef __linux__
+        p->fd = memfd_create("sdft_pool", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+#else
+        return SDFT_NOT_SUPPORTED;
+#endif
+    }
+    if (p->fd < 0) {
+        return system_error(p);
+    }
+
+    p->n_states = n_states;
+    p->slot_size = slot_size;
+    p->size = slots_offset() + n_states * p->slot_size;
+    if (ftruncate(p->fd, static_cast<off_t>(p->size)) != 0) {
+        return created_error(p, name);
+    }
+    void *base = mmap(0, p->size, PROT_READ | PROT_WRITE, MAP_SHARED, p->fd, 0);
+    if (base == MAP_FAILED) {
+        return created_error(p, name);
+    }
+    p->base = (char *) base;
+#ifdef __linux__
+    if (name == 0 && seal(p->fd) != 0) {
+        return system_error(p);
+    }
+#endif
+
+    for (size_t i = 0; i < n_states; ++i) {
+        new(sequence(p, i)) Sequence(0);
+        sdft_Error err = sdft_init_flat(sdft_pool_get_state(p, i), precision, window_size, signal_traits, kind);
+        if (err != SDFT_NO_ERROR) {
+            if (name != 0) {
+                shm_unlink(name);
+            }
+            sdft_pool_close(p);
+            return err;
+        }
+    }
+
+    // the header goes last, so readers never see a pool with uninitialized states
+    PoolHeader *header = (PoolHeader *) p->base;
+    header->reserved = 0;
+    header->n_states = n_states;
+    header->slot_size = p->slot_size;
+    header->size = p->size;
+    std::atomic_thread_fence(std::memory_order_release);
+    header->magic = pool_magic;
+
+    return SDFT_NO_ERROR;
+}
+
+enum sdft_Error sdft_pool_open(struct sdft_Pool *p, const char *name)
+{
+    reset(p);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) {
+        return system_error(p);
+    }
+
+    sdft_Error err = sdft_pool_open_fd(p, fd);
+    close(fd);
+    return err;
+}
+
+enum sdft_Error sdft_pool_open_fd(struct sdft_Pool *p, int fd)
+{
+    reset(p);
+    p->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    struct stat st;
+    if (p->fd < 0 || fstat(p->fd, &st) != 0) {
+        return system_error(p);
+    }
+    if (static_cast<size_t>(st.st_size) < sizeof(PoolHeader)) {
+        sdft_pool_close(p);
+        return SDFT_INVALID_FLAT_STATE;
+    }
+
+    p->size = static_cast<size_t>(st.st_size);
+    void *base = mmap(0, p->size, PROT_READ, MAP_SHARED, p->fd, 0);
+    if (base == MAP_FAILED) {
+        return system_error(p);
+    }
+    p->base = (char *) base;
+
+    const PoolHeader *header = (const PoolHeader *) p->base;
+    if (header->magic != pool_magic || header->size > p->size || header->size < slots_offset()
+            || header->slot_size < cache_line
+            || header->n_states > (header->size - slots_offset()) / header->slot_size) {
+        sdft_pool_close(p);
+        return SDFT_INVALID_FLAT_STATE;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    p->n_states = static_cast<size_t>(header->n_states);
+    p->slot_size = static_cast<size_t>(header->slot_size);
+
+    return SDFT_NO_ERROR;
+}
+
+void sdft_pool_close(struct sdft_Pool *p)
+{
+    if (p->base != 0) {
+        munmap(p->base, p->size);
+    }
+    if (p->fd >= 0) {
+        close(p->fd);
+    }
+    reset(p);
+}
+
+int sdft_pool_get_fd(const struct sdft_Pool *p)
+{
+    return p->fd;
+}
+
+size_t sdft_pool_get_number_of_states(const struct sdft_Pool *p)
+{
+    return p->n_states;
+}
+
+struct sdft_FlatState *sdft_pool_get_state(const struct sdft_Pool *p, size_t index)
+{
+    if (index >= p->n_states) {
+        return 0;
+    }
+
+    return (struct sdft_FlatState *) ((char *) sequence(p, index) + cache_line);
+}
+
+void sdft_pool_begin_write(struct sdft_Pool *p, size_t index)
+{
+    Sequence *seq = sequence(p, index);
+    seq->store(seq->load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+void sdft_pool_end_write(struct sdft_Pool *p, size_t index)
+{
+    Sequence *seq = sequence(p, index);
+    seq->store(seq->load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+unsigned long long sdft_pool_begin_read(const struct sdft_Pool *p, size_t index)
+{
+    const Sequence *seq = sequence(p, index);
+    unsigned long long token;
+    while ((token = seq->load(std::memory_order_acquire)) & 1) {
+        // the writer is in the middle of a push
+    }
+
+    return token;
+}
+
+int sdft_pool_end_read(const struct sdft_Pool *p, size_t index, unsigned long long token)
+{
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return sequence(p, index)->load(std::memory_order_relaxed) == token;
+}
+
+size_t sdft_pool_read_spectrum(const struct sdft_Pool *p, size_t index, void *spectrum)
+{
+    const struct sdft_FlatState *flat = sdft_pool_get_state(p, index);
+    // the header is only as trustworthy as the writer, so everything read from it is bounded by the slot
+    const size_t flat_size = p->slot_size - cache_line;
+    size_t n_bins;
+    unsigned long long token;
+    do {
+        token = sdft_pool_begin_read(p, index);
+        // the configuration never changes, but which spectrum is valid does
+        const size_t complex_size = flat->precision == SDFT_SINGLE ? 2 * sizeof(float)
+                : flat->precision == SDFT_DOUBLE ? 2 * sizeof(double) : 2 * sizeof(long double);
+        const uint64_t window_size = flat->window_size;
+        const uint64_t spectra_offset = flat->spectra_offset;
+        const bool combined = flat->kind == SDFT_FLAT_COMBINED;
+        const bool second = combined && flat->clear_counter > window_size;
+        if (window_size > flat_size / (2 * complex_size)
+                || spectra_offset > flat_size - (combined ? 2 : 1) * window_size * complex_size) {
+            n_bins = 0;
+            continue;
+        }
+
+        n_bins = static_cast<size_t>(flat->signal_traits == SDFT_REAL_AND_IMAG ? window_size : window_size / 2);
+        const char *first = (const char *) flat + spectra_offset;
+        std::memcpy(spectrum, first + (second ? window_size * complex_size : 0), n_bins * complex_size);
+    } while (!sdft_pool_end_read(p, index, token));
+
+    return n_bins;
+}
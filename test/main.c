@@ -1,12 +1,20 @@
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
 
 #include "sdft/sdft.h"
+#include "sdft/sdft_pipeline.h"
+#include "sdft/sdft_pool.h"
 #include "minunit.h"
 #include "my_complex.h"
 
+#if defined(SDFT_HAVE_POOL) && defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 int tests_run = 0;
 
 void dft(my_complex *signal, my_complex *spec, size_t N)
@@ -136,16 +144,38 @@ char *combined_sdft(my_complex *signal, size_t signal_length, enum sdft_SignalTr
     return msg;
 }
 
+char *shared_combined_sdft(my_complex *signal, size_t signal_length, enum sdft_SignalTraits traits,
+        size_t window_size)
+{
+    // Compared to combined_sdft, only the spectrum buffer has to be twice as big.
+    my_complex *window_buffer = calloc(window_size, sizeof(my_complex));
+    my_complex *spec_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *phase_buffer = malloc(sizeof(my_complex) * window_size);
+    struct sdft_State *s = malloc(sdft_size_of_state());
+
+    MU_ASSERT("shared combined init failed", sdft_init_shared_combined(s, SDFT_DOUBLE, window_buffer, spec_buffer,
+            phase_buffer, window_size, traits) == SDFT_NO_ERROR);
+
+    char *msg = compare_sdft_to_dft(s, signal, signal_length, traits, window_size);
+
+    free(s);
+    free(window_buffer);
+    free(spec_buffer);
+    free(phase_buffer);
+
+    return msg;
+}
+
 char *run_all_combinations(my_complex *signal, size_t signal_length, enum sdft_SignalTraits traits)
 {
-    // runs all combinations of test functions (simple, combined) and window_sizes (1..signal_length)
+    // runs all combinations of test functions (simple, combined, shared combined) and window_sizes (1..signal_length)
 
     typedef char *(*dft_function)(my_complex *, size_t, enum sdft_SignalTraits, size_t);
-    dft_function test_functions[2] = {&simple_sdft, &combined_sdft};
+    dft_function test_functions[3] = {&simple_sdft, &combined_sdft, &shared_combined_sdft};
 
     char *msg;
     for (size_t window_size = 1; window_size < signal_length; ++window_size) {
-        for (size_t i = 0; i < 2; ++i) {
+        for (size_t i = 0; i < 3; ++i) {
             if ((msg = test_functions[i](signal, signal_length, traits, window_size))) {
                 return msg;
             }
@@ -191,8 +221,292 @@ char *test_imag_signal()
     return run_all_combinations(signal, 16, SDFT_IMAG_ONLY);
 }
 
+char *paired_sdft(my_complex *signal, size_t signal_length, size_t window_size, double time_constant)
+{
+    // Channel x is the signal, channel y the signal reversed. Both start with an empty window.
+    my_complex *window_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *spec_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *phase_buffer = malloc(sizeof(my_complex) * 2 * window_size);
+    my_complex *cross_buffer = malloc(sizeof(my_complex) * window_size);
+    double *auto_buffer = malloc(sizeof(double) * 2 * window_size);
+    double *coherence = malloc(sizeof(double) * window_size);
+
+    struct sdft_State *x = malloc(sdft_size_of_state());
+    struct sdft_State *y = malloc(sdft_size_of_state());
+    struct sdft_State *paired = malloc(sdft_size_of_state());
+    sdft_init_from_buffers(x, SDFT_DOUBLE, window_buffer, spec_buffer, phase_buffer, window_size,
+            SDFT_REAL_AND_IMAG);
+    sdft_init_from_buffers(y, SDFT_DOUBLE, window_buffer + window_size, spec_buffer + window_size,
+            phase_buffer + window_size, window_size, SDFT_REAL_AND_IMAG);
+    MU_ASSERT("pairing failed",
+            sdft_init_paired(paired, x, y, cross_buffer, auto_buffer, time_constant) == SDFT_NO_ERROR);
+
+    // The expected averages are computed from DFTs of the zero padded history.
+    double alpha = time_constant > 0 ? 1 - exp(-1 / time_constant) : 1;
+    my_complex *padded = calloc(signal_length + window_size, sizeof(my_complex));
+    my_complex *y_window = malloc(sizeof(my_complex) * window_size);
+    my_complex *expected_x = malloc(sizeof(my_complex) * window_size);
+    my_complex *expected_y = malloc(sizeof(my_complex) * window_size);
+    my_complex *expected_cross = calloc(window_size, sizeof(my_complex));
+    double *expected_auto = calloc(2 * window_size, sizeof(double));
+    for (size_t i = 0; i < signal_length; ++i) {
+        my_complex samples[2] = {signal[i], signal[signal_length - 1 - i]};
+        sdft_push_next_sample(paired, samples);
+
+        padded[window_size + i] = samples[0];
+        dft(padded + i + 1, expected_x, window_size);
+        for (size_t j = 0; j < window_size; ++j) {
+            // the y window is ordered temporally, too: j == window_size - 1 is the sample pushed last
+            y_window[j] = i + 1 + j >= window_size
+                    ? signal[signal_length - 1 - (i + 1 + j - window_size)]
+                    : my_complex_zero;
+        }
+        dft(y_window, expected_y, window_size);
+        for (size_t k = 0; k < window_size; ++k) {
+            my_complex conj_y = {expected_y[k].real, -expected_y[k].imag};
+            my_complex xy = my_complex_mult(expected_x + k, &conj_y);
+            expected_cross[k].real += alpha * (xy.real - expected_cross[k].real);
+            expected_cross[k].imag += alpha * (xy.imag - expected_cross[k].imag);
+            double xx = my_complex_abs(expected_x + k), yy = my_complex_abs(expected_y + k);
+            expected_auto[k] += alpha * (xx * xx - expected_auto[k]);
+            expected_auto[window_size + k] += alpha * (yy * yy - expected_auto[window_size + k]);
+        }
+    }
+
+    my_complex *actual_cross = sdft_get_cross_spectrum(paired);
+    double *actual_x = sdft_get_auto_spectrum(paired, 0);
+    double *actual_y = sdft_get_auto_spectrum(paired, 1);
+    MU_ASSERT("spectrum of paired state isn't the cross-spectrum", sdft_get_spectrum(paired) == actual_cross);
+    MU_ASSERT("there is no third channel", sdft_get_auto_spectrum(paired, 2) == 0);
+    MU_ASSERT("paired state can't average", sdft_enable_averaging(paired, 0, 1, 1) == SDFT_NOT_SUPPORTED);
+    MU_ASSERT("coherence failed", sdft_get_coherence(paired, coherence) == SDFT_NO_ERROR);
+    for (size_t k = 0; k < window_size; ++k) {
+        my_complex delta = my_complex_sub(actual_cross + k, expected_cross + k);
+        double scale = 1 + expected_auto[k] + expected_auto[window_size + k];
+        MU_ASSERT("cross-spectrum isn't equal to that of the dft", my_complex_abs(&delta) < 1e-9 * scale);
+        MU_ASSERT("auto-spectrum of x isn't equal to that of the dft",
+                fabs(actual_x[k] - expected_auto[k]) < 1e-9 * scale);
+        MU_ASSERT("auto-spectrum of y isn't equal to that of the dft",
+                fabs(actual_y[k] - expected_auto[window_size + k]) < 1e-9 * scale);
+        MU_ASSERT("coherence out of range", coherence[k] >= 0 && coherence[k] <= 1 + 1e-9);
+        MU_ASSERT("coherence of unaveraged spectra isn't 1",
+                time_constant > 0 || actual_x[k] * actual_y[k] == 0 || fabs(coherence[k] - 1) < 1e-9);
+    }
+
+    free(padded);
+    free(y_window);
+    free(expected_x);
+    free(expected_y);
+    free(expected_cross);
+    free(expected_auto);
+    free(x);
+    free(y);
+    free(paired);
+    free(window_buffer);
+    free(spec_buffer);
+    free(phase_buffer);
+    free(cross_buffer);
+    free(auto_buffer);
+    free(coherence);
+
+    return 0;
+}
+
+char *test_paired_signal()
+{
+    my_complex signal[] = {
+            {51, 0}, {2, 0}, {42, 5}, {0.2, 0.5},
+            {1, 0}, {765, 0}, {34, 0}, {2903, 0},
+            {4096, 256}, {0, 5334}, {3, 0}, {6, 0},
+            {4, 0}, {1, 0}, {0, 74}, {79, 74.5}
+    };
+
+    double time_constants[] = {0, 1, 4.5};
+    char *msg;
+    for (size_t window_size = 1; window_size < 16; ++window_size) {
+        for (size_t i = 0; i < 3; ++i) {
+            if ((msg = paired_sdft(signal, 16, window_size, time_constants[i]))) {
+                return msg;
+            }
+            tests_run++;
+        }
+    }
+    return 0;
+}
+
+char *averaged_sdft(my_complex *signal, size_t signal_length, size_t window_size, int combine,
+        double time_constant, size_t hop_size)
+{
+    my_complex *window_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *spec_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *phase_buffer = malloc(sizeof(my_complex) * 2 * window_size);
+    double *power = malloc(sizeof(double) * window_size);
+
+    struct sdft_State *fst = malloc(sdft_size_of_state());
+    struct sdft_State *snd = malloc(sdft_size_of_state());
+    struct sdft_State *combined = malloc(sdft_size_of_state());
+    sdft_init_from_buffers(fst, SDFT_DOUBLE, window_buffer, spec_buffer, phase_buffer, window_size,
+            SDFT_REAL_AND_IMAG);
+    sdft_init_from_buffers(snd, SDFT_DOUBLE, window_buffer + window_size, spec_buffer + window_size,
+            phase_buffer + window_size, window_size, SDFT_REAL_AND_IMAG);
+    sdft_init_combine(combined, fst, snd);
+    struct sdft_State *s = combine ? combined : fst;
+
+    MU_ASSERT("negative time constant accepted", sdft_enable_averaging(s, power, -1, 1) == SDFT_INVALID_TIME_CONSTANT);
+    MU_ASSERT("hop size 0 accepted", sdft_enable_averaging(s, power, 1, 0) == SDFT_INVALID_HOP_SIZE);
+    MU_ASSERT("averaging enabled", sdft_get_averaged_power(s) == 0);
+    MU_ASSERT("averaging failed", sdft_enable_averaging(s, power, time_constant, hop_size) == SDFT_NO_ERROR);
+    MU_ASSERT("wrong averaged power buffer", sdft_get_averaged_power(s) == power);
+
+    double alpha = time_constant > 0 ? 1 - exp(-1 / time_constant) : 1;
+    my_complex *padded = calloc(signal_length + window_size, sizeof(my_complex));
+    my_complex *spec = malloc(sizeof(my_complex) * window_size);
+    double *expected = calloc(window_size, sizeof(double));
+    for (size_t i = 0; i < signal_length; ++i) {
+        sdft_push_next_sample(s, signal + i);
+
+        padded[window_size + i] = signal[i];
+        if ((i + 1) % hop_size == 0) {
+            dft(padded + i + 1, spec, window_size);
+            for (size_t k = 0; k < window_size; ++k) {
+                double abs = my_complex_abs(spec + k);
+                expected[k] += alpha * (abs * abs - expected[k]);
+            }
+        }
+    }
+
+    for (size_t k = 0; k < window_size; ++k) {
+        MU_ASSERT("averaged power isn't equal to that of the dft",
+                fabs(power[k] - expected[k]) < 1e-9 * (1 + expected[k]));
+    }
+
+    free(padded);
+    free(spec);
+    free(expected);
+    free(fst);
+    free(snd);
+    free(combined);
+    free(window_buffer);
+    free(spec_buffer);
+    free(phase_buffer);
+    free(power);
+
+    return 0;
+}
+
+char *test_averaged_signal()
+{
+    my_complex signal[] = {
+            {51, 0}, {2, 0}, {42, 5}, {0.2, 0.5},
+            {1, 0}, {765, 0}, {34, 0}, {2903, 0},
+            {4096, 256}, {0, 5334}, {3, 0}, {6, 0},
+            {4, 0}, {1, 0}, {0, 74}, {79, 74.5}
+    };
+
+    char *msg;
+    for (size_t window_size = 1; window_size < 16; ++window_size) {
+        for (int combine = 0; combine < 2; ++combine) {
+            for (size_t hop_size = 1; hop_size < 4; ++hop_size) {
+                if ((msg = averaged_sdft(signal, 16, window_size, combine, 2.5, hop_size))) {
+                    return msg;
+                }
+                tests_run++;
+            }
+        }
+    }
+    return 0;
+}
+
+void dct(double *signal, my_complex *coefficients, size_t N, enum sdft_CosineKind kind)
+{
+    const double pi = 3.141592653589793238462643383279502884;
+    double offset = kind == SDFT_DCT_IV ? 0.5 : 0;
+    for (size_t k = 0; k < N; ++k) {
+        coefficients[k] = my_complex_zero;
+        for (size_t n = 0; n < N; ++n) {
+            double angle = pi / N * (k + offset) * (n + 0.5);
+            coefficients[k].real += signal[n] * cos(angle);
+            coefficients[k].imag += signal[n] * sin(angle);
+        }
+    }
+}
+
+char *cosine_sdft(double *signal, size_t signal_length, enum sdft_CosineKind kind, size_t window_size, int combine)
+{
+    double *window_buffer = calloc(2 * window_size, sizeof(double));
+    my_complex *coefficient_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *twiddle_buffer = malloc(sizeof(my_complex) * 4 * window_size);
+
+    struct sdft_State *fst = malloc(sdft_size_of_state());
+    struct sdft_State *snd = malloc(sdft_size_of_state());
+    struct sdft_State *combined = malloc(sdft_size_of_state());
+    MU_ASSERT("dct init failed", sdft_init_dct_from_buffers(fst, SDFT_DOUBLE, window_buffer, coefficient_buffer,
+            twiddle_buffer, window_size, kind) == SDFT_NO_ERROR);
+    MU_ASSERT("dct init failed", sdft_init_dct_from_buffers(snd, SDFT_DOUBLE, window_buffer + window_size,
+            coefficient_buffer + window_size, twiddle_buffer + 2 * window_size, window_size, kind) == SDFT_NO_ERROR);
+    MU_ASSERT("dct combine failed", sdft_init_combine(combined, fst, snd) == SDFT_NO_ERROR);
+    struct sdft_State *s = combine ? combined : fst;
+
+    for (size_t i = 0; i < signal_length; ++i) {
+        sdft_push_next_sample(s, signal + i);
+    }
+
+    double *window = sdft_unshift_and_get_window(s);
+    size_t signal_offset = signal_length - window_size;
+    for (size_t i = 0; i < window_size; ++i) {
+        MU_ASSERT("window values don't equal signal", window[i] == signal[signal_offset + i]);
+    }
+
+    my_complex *expected = malloc(sizeof(my_complex) * window_size);
+    dct(signal + signal_offset, expected, window_size, kind);
+    my_complex *actual = sdft_get_spectrum(s);
+    for (size_t k = 0; k < window_size; ++k) {
+        my_complex delta = my_complex_sub(actual + k, expected + k);
+        MU_ASSERT("coefficients aren't equal to those of the dct", my_complex_abs(&delta) < 0.001);
+    }
+
+    free(expected);
+    free(fst);
+    free(snd);
+    free(combined);
+    free(window_buffer);
+    free(coefficient_buffer);
+    free(twiddle_buffer);
+
+    return 0;
+}
+
 #include "actual_signal.h"
 
+char *test_cosine_signal()
+{
+    const size_t N = 128;
+    double signal[128];
+    for (size_t i = 0; i < N; ++i) {
+        signal[i] = actual_signal[i];
+    }
+
+    enum sdft_CosineKind kinds[] = {SDFT_DCT_II, SDFT_DCT_IV};
+    char *msg;
+    for (size_t window_size = 1; window_size < N; ++window_size) {
+        for (size_t i = 0; i < 4; ++i) {
+            if ((msg = cosine_sdft(signal, N, kinds[i / 2], window_size, i % 2))) {
+                return msg;
+            }
+            tests_run++;
+        }
+    }
+
+    double window[4] = {0};
+    my_complex buffer[12] = {{0, 0}};
+    struct sdft_State *state = malloc(sdft_size_of_state());
+    MU_ASSERT("unknown cosine kind accepted", sdft_init_dct_from_buffers(state, SDFT_DOUBLE, window, buffer,
+            buffer + 4, 4, (enum sdft_CosineKind) (SDFT_DCT_IV + 1)) == SDFT_NOT_SUPPORTED);
+    free(state);
+
+    return 0;
+}
+
 char *test_actual_signal()
 {
     const size_t N = 512;
@@ -205,12 +519,1463 @@ char *test_actual_signal()
     return run_all_combinations(signal, N, SDFT_REAL_AND_IMAG);
 }
 
+void fractional_dft(my_complex *signal, my_complex *spec, size_t N, const double *bins, size_t n_bins)
+{
+    for (size_t k = 0; k < n_bins; ++k) {
+        spec[k] = my_complex_zero;
+        for (size_t j = 0; j < N; ++j) {
+            const double double_pi = 2 * 3.141592653589793238462643383279502884;
+            double angle = -double_pi * bins[k] * j / N;
+            my_complex tmp = {cos(angle), sin(angle)};
+            tmp = my_complex_mult(signal + j, &tmp);
+            spec[k] = my_complex_add(spec + k, &tmp);
+        }
+    }
+}
+
+char *goertzel_sdft(my_complex *signal, size_t signal_length, enum sdft_SignalTraits traits, size_t window_size,
+        const double *bins, size_t n_bins, int combine)
+{
+    my_complex *window_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *spec_buffer = malloc(sizeof(my_complex) * 2 * n_bins);
+    my_complex *coefficient_buffer = malloc(sizeof(my_complex) * 6 * n_bins);
+    my_complex *resonator_buffer = malloc(sizeof(my_complex) * 8 * n_bins);
+
+    // start with a non-empty window, which the detectors have to pick up
+    memcpy(window_buffer, signal, sizeof(my_complex) * window_size);
+
+    struct sdft_State *fst = malloc(sdft_size_of_state());
+    struct sdft_State *snd = malloc(sdft_size_of_state());
+    struct sdft_State *combined = malloc(sdft_size_of_state());
+    MU_ASSERT("goertzel init failed", sdft_init_goertzel_from_buffers(fst, SDFT_DOUBLE, window_buffer, spec_buffer,
+            coefficient_buffer, resonator_buffer, window_size, traits, bins, n_bins) == SDFT_NO_ERROR);
+    MU_ASSERT("goertzel init failed", sdft_init_goertzel_from_buffers(snd, SDFT_DOUBLE, window_buffer + window_size,
+            spec_buffer + n_bins, coefficient_buffer + 3 * n_bins, resonator_buffer + 4 * n_bins, window_size,
+            traits, bins, n_bins) == SDFT_NO_ERROR);
+    MU_ASSERT("goertzel combine failed", sdft_init_combine(combined, fst, snd) == SDFT_NO_ERROR);
+    struct sdft_State *s = combine ? combined : fst;
+
+    for (size_t i = window_size; i < signal_length; ++i) {
+        sdft_push_next_sample(s, signal + i);
+    }
+
+    my_complex *actual = sdft_get_spectrum(s);
+    my_complex *window = sdft_unshift_and_get_window(s);
+    size_t signal_offset = signal_length - window_size;
+    for (size_t i = 0; i < window_size; ++i) {
+        MU_ASSERT("window values don't equal signal", my_complex_equal(window + i, signal + signal_offset + i));
+    }
+
+    my_complex *expected = malloc(sizeof(my_complex) * n_bins);
+    fractional_dft(signal + signal_offset, expected, window_size, bins, n_bins);
+    for (size_t k = 0; k < n_bins; ++k) {
+        my_complex delta = my_complex_sub(actual + k, expected + k);
+        MU_ASSERT("spectrum isn't equal to that of the dft", my_complex_abs(&delta) < 0.001);
+    }
+
+    free(expected);
+    free(fst);
+    free(snd);
+    free(combined);
+    free(window_buffer);
+    free(spec_buffer);
+    free(coefficient_buffer);
+    free(resonator_buffer);
+
+    return 0;
+}
+
+// A sample of a signal with components at bins 0, 32 and 3.25 of a 64-point window, periodic with 256 samples.
+float goertzel_long_run_sample(size_t i)
+{
+    const double double_pi = 2 * 3.141592653589793238462643383279502884;
+    return (float) (1 + 0.5 * (i % 2 ? -1 : 1) + cos(double_pi * 3.25 * (double) (i % 256) / 64));
+}
+
+// Pushes 2^20 samples into a single precision state on the given bins, whose spectrum must not drift away.
+char *goertzel_long_run(const double *bins, size_t n_bins)
+{
+    const size_t window_size = 64;
+    const size_t n_pushes = 1 << 20;
+    float window[2 * 64] = {0};
+    float spectrum[2 * 2], coefficients[3 * 2 * 2], resonators[4 * 2 * 2];
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    MU_ASSERT("goertzel init failed", sdft_init_goertzel_from_buffers(s, SDFT_SINGLE, window, spectrum, coefficients,
+            resonators, window_size, SDFT_REAL_ONLY, bins, n_bins) == SDFT_NO_ERROR);
+    for (size_t i = 0; i < n_pushes; ++i) {
+        float sample[2] = {goertzel_long_run_sample(i), 0};
+        sdft_push_next_sample(s, sample);
+    }
+
+    my_complex signal[64];
+    for (size_t j = 0; j < window_size; ++j) {
+        signal[j].real = goertzel_long_run_sample(n_pushes - window_size + j);
+        signal[j].imag = 0;
+    }
+    my_complex expected[2];
+    fractional_dft(signal, expected, window_size, bins, n_bins);
+    float *actual = sdft_get_spectrum(s);
+    for (size_t k = 0; k < n_bins; ++k) {
+        my_complex a = {actual[2 * k], actual[2 * k + 1]};
+        my_complex delta = my_complex_sub(&a, expected + k);
+        MU_ASSERT("goertzel spectrum drifted over a long run", my_complex_abs(&delta) < 0.01);
+    }
+    free(s);
+
+    return 0;
+}
+
+char *test_goertzel_signal()
+{
+    const size_t N = 96;
+    my_complex signals[3][96];
+    for (size_t i = 0; i < N; ++i) {
+        my_complex mixed = {actual_signal[i], actual_signal[N - 1 - i]};
+        my_complex real = {actual_signal[i], 0};
+        my_complex imag = {0, actual_signal[i]};
+        signals[0][i] = mixed;
+        signals[1][i] = real;
+        signals[2][i] = imag;
+    }
+    enum sdft_SignalTraits traits[] = {SDFT_REAL_AND_IMAG, SDFT_REAL_ONLY, SDFT_IMAG_ONLY};
+
+    double integral_bins[] = {0, 1, 3, 2};
+    double fractional_bins[] = {0.5, 1, 3.25, 2.9, 0};
+    double invalid_bins[] = {1, NAN};
+
+    char *msg;
+    for (size_t window_size = 1; window_size < 48; ++window_size) {
+        for (size_t i = 0; i < 12; ++i) {
+            int fractional = (i / 2) % 2;
+            if ((msg = goertzel_sdft(signals[i / 4], N, traits[i / 4], window_size,
+                    fractional ? fractional_bins : integral_bins, fractional ? 5 : 4, i % 2))) {
+                return msg;
+            }
+            tests_run++;
+        }
+    }
+
+    my_complex buffer[16] = {{0, 0}};
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    MU_ASSERT("non-finite bin accepted", sdft_init_goertzel_from_buffers(s, SDFT_DOUBLE, buffer, buffer + 4,
+            buffer + 4, buffer + 8, 4, SDFT_REAL_AND_IMAG, invalid_bins, 2) == SDFT_INVALID_FREQUENCIES);
+    MU_ASSERT("empty bins accepted", sdft_init_goertzel_from_buffers(s, SDFT_DOUBLE, buffer, buffer + 4,
+            buffer + 4, buffer + 8, 4, SDFT_REAL_AND_IMAG, invalid_bins, 0) == SDFT_INVALID_FREQUENCIES);
+    free(s);
+
+    // the resonators of bins 0 and N/2 and of non-integral bins don't stay bounded on their own
+    double edge_bins[] = {0, 32};
+    double fractional_bin[] = {3.25};
+    if ((msg = goertzel_long_run(edge_bins, 2)) || (msg = goertzel_long_run(fractional_bin, 1))) {
+        return msg;
+    }
+    tests_run += 2;
+
+    // combined states skip a long gap in time independent of its length
+    my_complex fill = {-3.5, 12};
+    my_complex skip_buffer[2 * 8 + 2 * 5 + 6 * 5 + 8 * 5] = {{0, 0}};
+    struct sdft_State *fst = malloc(sdft_size_of_state());
+    struct sdft_State *snd = malloc(sdft_size_of_state());
+    struct sdft_State *combined = malloc(sdft_size_of_state());
+    sdft_init_goertzel_from_buffers(fst, SDFT_DOUBLE, skip_buffer, skip_buffer + 16, skip_buffer + 26,
+            skip_buffer + 56, 8, SDFT_REAL_AND_IMAG, fractional_bins, 5);
+    sdft_init_goertzel_from_buffers(snd, SDFT_DOUBLE, skip_buffer + 8, skip_buffer + 21, skip_buffer + 41,
+            skip_buffer + 76, 8, SDFT_REAL_AND_IMAG, fractional_bins, 5);
+    MU_ASSERT("goertzel combine failed", sdft_init_combine(combined, fst, snd) == SDFT_NO_ERROR);
+    for (size_t i = 0; i < 11; ++i) {
+        sdft_push_next_sample(combined, signals[0] + i);
+    }
+    MU_ASSERT("skipping failed", sdft_skip_samples(combined, 100000003, &fill) == SDFT_NO_ERROR);
+    my_complex fill_window[8] = {fill, fill, fill, fill, fill, fill, fill, fill};
+    my_complex expected[5];
+    fractional_dft(fill_window, expected, 8, fractional_bins, 5);
+    my_complex *actual = sdft_get_spectrum(combined);
+    for (size_t k = 0; k < 5; ++k) {
+        my_complex delta = my_complex_sub(actual + k, expected + k);
+        MU_ASSERT("spectrum after a long gap isn't equal to that of the dft", my_complex_abs(&delta) < 0.001);
+    }
+    free(fst);
+    free(snd);
+    free(combined);
+    tests_run++;
+
+    return 0;
+}
+
+char *bins_sdft(my_complex *signal, size_t signal_length, enum sdft_SignalTraits traits, size_t window_size,
+        const double *bins, size_t n_bins, int combine)
+{
+    my_complex *window_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *spec_buffer = calloc(2 * n_bins, sizeof(my_complex));
+    my_complex *phase_buffer = malloc(sizeof(my_complex) * 4 * n_bins);
+
+    struct sdft_State *fst = malloc(sdft_size_of_state());
+    struct sdft_State *snd = malloc(sdft_size_of_state());
+    struct sdft_State *combined = malloc(sdft_size_of_state());
+    MU_ASSERT("init from bins failed", sdft_init_from_bins(fst, SDFT_DOUBLE, window_buffer, spec_buffer,
+            phase_buffer, window_size, traits, bins, n_bins) == SDFT_NO_ERROR);
+    MU_ASSERT("init from bins failed", sdft_init_from_bins(snd, SDFT_DOUBLE, window_buffer + window_size,
+            spec_buffer + n_bins, phase_buffer + 2 * n_bins, window_size, traits, bins, n_bins) == SDFT_NO_ERROR);
+    MU_ASSERT("combine failed", sdft_init_combine(combined, fst, snd) == SDFT_NO_ERROR);
+    struct sdft_State *s = combine ? combined : fst;
+
+    for (size_t i = 0; i < signal_length; ++i) {
+        sdft_push_next_sample(s, signal + i);
+    }
+
+    size_t signal_offset = signal_length - window_size;
+    my_complex *expected = malloc(sizeof(my_complex) * n_bins);
+    fractional_dft(signal + signal_offset, expected, window_size, bins, n_bins);
+    my_complex *actual = sdft_get_spectrum(s);
+    for (size_t k = 0; k < n_bins; ++k) {
+        my_complex delta = my_complex_sub(actual + k, expected + k);
+        MU_ASSERT("spectrum isn't equal to that of the dft", my_complex_abs(&delta) < 0.001);
+    }
+
+    free(expected);
+    free(fst);
+    free(snd);
+    free(combined);
+    free(window_buffer);
+    free(spec_buffer);
+    free(phase_buffer);
+
+    return 0;
+}
+
+char *test_bins_signal()
+{
+    const size_t N = 96;
+    my_complex signal[96];
+    for (size_t i = 0; i < N; ++i) {
+        signal[i].real = actual_signal[i];
+        signal[i].imag = actual_signal[N - 1 - i];
+    }
+
+    double bins[] = {0.5, 1, 3.25, 2.9, 0, 50.3};
+
+    char *msg;
+    for (size_t window_size = 1; window_size < 48; ++window_size) {
+        for (int combine = 0; combine < 2; ++combine) {
+            if ((msg = bins_sdft(signal, N, SDFT_REAL_AND_IMAG, window_size, bins, 6, combine))) {
+                return msg;
+            }
+            tests_run++;
+        }
+    }
+
+    // states over different bins can't be combined
+    my_complex buffer[16] = {{0, 0}};
+    struct sdft_State *fst = malloc(sdft_size_of_state());
+    struct sdft_State *snd = malloc(sdft_size_of_state());
+    struct sdft_State *combined = malloc(sdft_size_of_state());
+    sdft_init_from_bins(fst, SDFT_DOUBLE, buffer, buffer + 4, buffer + 6, 4, SDFT_REAL_AND_IMAG, bins, 1);
+    sdft_init_from_bins(snd, SDFT_DOUBLE, buffer + 8, buffer + 12, buffer + 14, 4, SDFT_REAL_AND_IMAG, bins + 1, 1);
+    MU_ASSERT("different bins combined", sdft_init_combine(combined, fst, snd) == SDFT_NOT_COMBINABLE);
+    MU_ASSERT("lazy rotation enabled on bins", sdft_enable_lazy_rotation(fst, 1) == SDFT_NOT_SUPPORTED);
+    free(fst);
+    free(snd);
+    free(combined);
+
+    return 0;
+}
+
+char *constant_q_sdft(my_complex *signal, size_t signal_length, double min_frequency, size_t bins_per_octave,
+        size_t n_bins, int combine)
+{
+    size_t window_size = sdft_constant_q_window_size(min_frequency, bins_per_octave);
+    my_complex *window_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *spec_buffer = malloc(sizeof(my_complex) * 2 * n_bins);
+    my_complex *coefficient_buffer = malloc(sizeof(my_complex) * 4 * n_bins);
+    size_t *lengths = malloc(sizeof(size_t) * 2 * n_bins);
+
+    // start with a non-empty window, from which the initial spectrum is computed
+    memcpy(window_buffer, signal, sizeof(my_complex) * window_size);
+
+    struct sdft_State *fst = malloc(sdft_size_of_state());
+    struct sdft_State *snd = malloc(sdft_size_of_state());
+    struct sdft_State *combined = malloc(sdft_size_of_state());
+    MU_ASSERT("window too short accepted", sdft_init_constant_q_from_buffers(fst, SDFT_DOUBLE, window_buffer,
+            spec_buffer, coefficient_buffer, lengths, window_size - 1, SDFT_REAL_AND_IMAG, min_frequency,
+            bins_per_octave, n_bins) == SDFT_WINDOW_TOO_SHORT);
+    MU_ASSERT("constant-Q init failed", sdft_init_constant_q_from_buffers(fst, SDFT_DOUBLE, window_buffer,
+            spec_buffer, coefficient_buffer, lengths, window_size, SDFT_REAL_AND_IMAG, min_frequency,
+            bins_per_octave, n_bins) == SDFT_NO_ERROR);
+    MU_ASSERT("constant-Q init failed", sdft_init_constant_q_from_buffers(snd, SDFT_DOUBLE,
+            window_buffer + window_size, spec_buffer + n_bins, coefficient_buffer + 2 * n_bins, lengths + n_bins,
+            window_size, SDFT_REAL_AND_IMAG, min_frequency, bins_per_octave, n_bins) == SDFT_NO_ERROR);
+    MU_ASSERT("constant-Q combine failed", sdft_init_combine(combined, fst, snd) == SDFT_NO_ERROR);
+    struct sdft_State *s = combine ? combined : fst;
+    MU_ASSERT("lowest bin doesn't span the window", lengths[0] == window_size);
+
+    for (size_t i = window_size; i < signal_length; ++i) {
+        sdft_push_next_sample(s, signal + i);
+    }
+
+    my_complex *actual = sdft_get_spectrum(s);
+    double q = 1 / (pow(2, 1.0 / bins_per_octave) - 1);
+    for (size_t k = 0; k < n_bins; ++k) {
+        double frequency = min_frequency * pow(2, (double) k / bins_per_octave);
+        MU_ASSERT("wrong window length", lengths[k] == (size_t) ceil(q / frequency));
+        MU_ASSERT("window lengths don't decrease", k == 0 || lengths[k] <= lengths[k - 1]);
+
+        // the frequency in cycles per window of bin k
+        double bin = frequency * lengths[k];
+        my_complex expected;
+        fractional_dft(signal + signal_length - lengths[k], &expected, lengths[k], &bin, 1);
+        my_complex delta = my_complex_sub(actual + k, &expected);
+        MU_ASSERT("spectrum isn't equal to that of the dft", my_complex_abs(&delta) < 0.001);
+    }
+
+    free(fst);
+    free(snd);
+    free(combined);
+    free(window_buffer);
+    free(spec_buffer);
+    free(coefficient_buffer);
+    free(lengths);
+
+    return 0;
+}
+
+char *test_constant_q_signal()
+{
+    const size_t N = 512;
+    my_complex signal[512];
+    for (size_t i = 0; i < N; ++i) {
+        signal[i].real = actual_signal[i];
+        signal[i].imag = actual_signal[N - 1 - i];
+    }
+
+    char *msg;
+    size_t bins_per_octave[] = {1, 4, 12};
+    for (size_t i = 0; i < 3; ++i) {
+        for (int combine = 0; combine < 2; ++combine) {
+            if ((msg = constant_q_sdft(signal, N, 0.05, bins_per_octave[i], 2 * bins_per_octave[i] + 1, combine))) {
+                return msg;
+            }
+            tests_run++;
+        }
+    }
+
+    MU_ASSERT("invalid frequency accepted", sdft_constant_q_window_size(0, 12) == 0);
+    MU_ASSERT("invalid bins per octave accepted", sdft_constant_q_window_size(0.1, 0) == 0);
+
+    return 0;
+}
+
+char *decimating_sdft(my_complex *signal, size_t signal_length, size_t factor, size_t taps_per_phase,
+        size_t window_size)
+{
+    size_t n_taps = factor * taps_per_phase;
+    my_complex *window_buffer = calloc(window_size, sizeof(my_complex));
+    my_complex *spec_buffer = calloc(window_size, sizeof(my_complex));
+    my_complex *phase_buffer = malloc(sizeof(my_complex) * window_size);
+    double *taps = malloc(sizeof(double) * n_taps);
+    my_complex *history = malloc(sizeof(my_complex) * 2 * n_taps);
+
+    struct sdft_State *inner = malloc(sdft_size_of_state());
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    sdft_init_from_buffers(inner, SDFT_DOUBLE, window_buffer, spec_buffer, phase_buffer, window_size,
+            SDFT_REAL_AND_IMAG);
+    MU_ASSERT("decimating init failed",
+            sdft_init_decimating(s, inner, factor, taps_per_phase, taps, history) == SDFT_NO_ERROR);
+
+    for (size_t i = 0; i < signal_length; ++i) {
+        sdft_push_next_sample(s, signal + i);
+    }
+
+    // The filter has unit gain at DC and is symmetric.
+    double sum = 0;
+    for (size_t j = 0; j < n_taps; ++j) {
+        sum += taps[j];
+        MU_ASSERT("filter isn't symmetric", fabs(taps[j] - taps[n_taps - 1 - j]) < 1e-12);
+    }
+    MU_ASSERT("filter doesn't have unit gain at DC", fabs(sum - 1) < 1e-12);
+
+    // Decimate the zero padded signal by hand: the inner state received the filter output after every factor-th
+    // sample.
+    size_t n_outputs = signal_length / factor;
+    my_complex *decimated = calloc(n_outputs + window_size, sizeof(my_complex));
+    for (size_t m = 0; m < n_outputs; ++m) {
+        my_complex *y = decimated + window_size + m;
+        for (size_t j = 0; j < n_taps && j <= (m + 1) * factor - 1; ++j) {
+            my_complex tmp = signal[(m + 1) * factor - 1 - j];
+            y->real += taps[j] * tmp.real;
+            y->imag += taps[j] * tmp.imag;
+        }
+    }
+
+    my_complex *expected = malloc(sizeof(my_complex) * window_size);
+    dft(decimated + n_outputs, expected, window_size);
+    my_complex *actual = sdft_get_spectrum(s);
+    for (size_t k = 0; k < window_size; ++k) {
+        my_complex delta = my_complex_sub(actual + k, expected + k);
+        MU_ASSERT("spectrum isn't equal to that of the decimated dft", my_complex_abs(&delta) < 0.001);
+        // the upper half of the bins are negative frequencies, i.e. aliased to just below the input sample rate
+        double bin = 2 * k < window_size ? k : (double) k - window_size;
+        double frequency = bin / window_size / factor;
+        MU_ASSERT("wrong bin frequency",
+                fabs(sdft_get_bin_frequency(s, k) - (frequency < 0 ? frequency + 1 : frequency)) < 1e-15);
+    }
+    MU_ASSERT("bin out of range has a frequency", isnan(sdft_get_bin_frequency(s, window_size)));
+
+    free(decimated);
+    free(expected);
+    free(inner);
+    free(s);
+    free(window_buffer);
+    free(spec_buffer);
+    free(phase_buffer);
+    free(taps);
+    free(history);
+
+    return 0;
+}
+
+char *test_decimating_signal()
+{
+    const size_t N = 512;
+    my_complex signal[512];
+    for (size_t i = 0; i < N; ++i) {
+        signal[i].real = actual_signal[i];
+        signal[i].imag = actual_signal[N - 1 - i];
+    }
+
+    char *msg;
+    size_t factors[] = {1, 2, 3, 8};
+    for (size_t i = 0; i < 4; ++i) {
+        for (size_t taps_per_phase = 1; taps_per_phase < 8; taps_per_phase += 3) {
+            for (size_t window_size = 1; window_size < 32; window_size += 5) {
+                if ((msg = decimating_sdft(signal, N, factors[i], taps_per_phase, window_size))) {
+                    return msg;
+                }
+                tests_run++;
+            }
+        }
+    }
+
+    // A tone in the stop band is suppressed, one in the pass band is not.
+    const double double_pi = 2 * 3.141592653589793238462643383279502884;
+    const size_t factor = 8, window_size = 32;
+    double tones[] = {0.3, 5.0 / window_size / factor};
+    for (size_t t = 0; t < 2; ++t) {
+        my_complex window_buffer[32] = {{0, 0}}, spec_buffer[32] = {{0, 0}}, phase_buffer[32], history[2 * 8 * 16];
+        double taps[8 * 16];
+        struct sdft_State *inner = malloc(sdft_size_of_state());
+        struct sdft_State *s = malloc(sdft_size_of_state());
+        sdft_init_from_buffers(inner, SDFT_DOUBLE, window_buffer, spec_buffer, phase_buffer, window_size,
+                SDFT_REAL_AND_IMAG);
+        sdft_init_decimating(s, inner, factor, 16, taps, history);
+        for (size_t i = 0; i < 4 * factor * window_size; ++i) {
+            my_complex sample = {cos(double_pi * tones[t] * i), sin(double_pi * tones[t] * i)};
+            sdft_push_next_sample(s, &sample);
+        }
+        my_complex *spectrum = sdft_get_spectrum(s);
+        double energy = 0;
+        for (size_t k = 0; k < window_size; ++k) {
+            energy += my_complex_abs(spectrum + k) * my_complex_abs(spectrum + k);
+        }
+        MU_ASSERT("stop band tone passed", t != 0 || energy < 1e-6 * window_size * window_size);
+        MU_ASSERT("pass band tone not at its bin", t != 1 || my_complex_abs(spectrum + 5) > 0.99 * window_size);
+        free(inner);
+        free(s);
+    }
+
+    // Samples violating the signal traits of inner are rejected without disturbing the filter, one by one as well as
+    // in blocks. The reference state never sees them.
+    my_complex buffers[2][3][8] = {{{{0, 0}}}};
+    my_complex histories[2][2 * 2 * 3];
+    double all_taps[2][2 * 3];
+    struct sdft_State *inners[2], *states[2];
+    for (size_t i = 0; i < 2; ++i) {
+        inners[i] = malloc(sdft_size_of_state());
+        states[i] = malloc(sdft_size_of_state());
+        sdft_init_from_buffers(inners[i], SDFT_DOUBLE, buffers[i][0], buffers[i][1], buffers[i][2], 8,
+                SDFT_REAL_ONLY);
+        MU_ASSERT("decimating init failed", sdft_init_decimating(states[i], inners[i], 2, 3, all_taps[i],
+                histories[i]) == SDFT_NO_ERROR);
+    }
+    my_complex violating[3] = {{1, 0}, {2, 1}, {3, 0}};
+    for (size_t i = 0; i < 40; ++i) {
+        my_complex sample = {actual_signal[i], 0};
+        if (i == 17) {
+            MU_ASSERT("violating sample accepted", sdft_push_next_sample(states[0], violating + 1)
+                    == SDFT_SIGNAL_TRAIT_VIOLATION);
+            MU_ASSERT("violating block accepted", sdft_catch_up(states[0], violating, 3)
+                    == SDFT_SIGNAL_TRAIT_VIOLATION);
+        }
+        MU_ASSERT("valid sample rejected", sdft_push_next_sample(states[0], &sample) == SDFT_NO_ERROR);
+        sdft_push_next_sample(states[1], &sample);
+    }
+    my_complex *actual = sdft_get_spectrum(states[0]);
+    my_complex *expected = sdft_get_spectrum(states[1]);
+    for (size_t k = 0; k < sdft_get_number_of_bins(states[0]); ++k) {
+        MU_ASSERT("violating sample disturbed the filter", my_complex_equal(actual + k, expected + k));
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        free(inners[i]);
+        free(states[i]);
+    }
+    tests_run++;
+
+    return 0;
+}
+
+char *test_zoom_signal()
+{
+    // Zoom into the band around 0.3 cycles per sample with 16 times the resolution of a full rate sdft.
+    const double double_pi = 2 * 3.141592653589793238462643383279502884;
+    const size_t factor = 16, window_size = 32;
+    const double center = 0.3;
+    my_complex window_buffer[32] = {{0, 0}}, spec_buffer[32] = {{0, 0}}, phase_buffer[32], history[2 * 16 * 8];
+    double taps[16 * 8];
+    struct sdft_State *inner = malloc(sdft_size_of_state());
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    sdft_init_from_buffers(inner, SDFT_DOUBLE, window_buffer, spec_buffer, phase_buffer, window_size,
+            SDFT_REAL_AND_IMAG);
+    MU_ASSERT("infinite center accepted",
+            sdft_init_zoom(s, inner, INFINITY, factor, 8, taps, history) == SDFT_INVALID_FREQUENCIES);
+    MU_ASSERT("zoom init failed", sdft_init_zoom(s, inner, center, factor, 8, taps, history) == SDFT_NO_ERROR);
+
+    // A real signal with tones 3 bins above and 2 bins below the center, of the baseband resolution.
+    const double resolution = 1.0 / window_size / factor;
+    const double above = center + 3 * resolution, below = center - 2 * resolution;
+    for (size_t i = 0; i < 20 * factor * window_size; ++i) {
+        my_complex sample = {cos(double_pi * above * i) + 0.5 * cos(double_pi * below * i), 0};
+        sdft_push_next_sample(s, &sample);
+    }
+
+    MU_ASSERT("wrong center frequency", fabs(sdft_get_bin_frequency(s, 0) - center) < 1e-12);
+    MU_ASSERT("wrong frequency above center", fabs(sdft_get_bin_frequency(s, 3) - above) < 1e-12);
+    MU_ASSERT("wrong frequency below center",
+            fabs(sdft_get_bin_frequency(s, window_size - 2) - below) < 1e-12);
+
+    // Each real tone contributes half of its amplitude at its positive frequency.
+    my_complex *spectrum = sdft_get_spectrum(s);
+    for (size_t k = 0; k < window_size; ++k) {
+        double expected = k == 3 ? 0.5 : k == window_size - 2 ? 0.25 : 0;
+        MU_ASSERT("wrong magnitude in zoomed spectrum",
+                fabs(my_complex_abs(spectrum + k) / window_size - expected) < 0.01);
+    }
+
+    // inner has to take the complex baseband signal as a whole
+    my_complex real_window[32] = {{0, 0}}, real_spec[32] = {{0, 0}}, real_phase[32];
+    sdft_init_from_buffers(inner, SDFT_DOUBLE, real_window, real_spec, real_phase, window_size, SDFT_REAL_ONLY);
+    MU_ASSERT("real inner state accepted",
+            sdft_init_zoom(s, inner, center, factor, 8, taps, history) == SDFT_NOT_SUPPORTED);
+    MU_ASSERT("real inner state rejected without mixing",
+            sdft_init_zoom(s, inner, 0, factor, 8, taps, history) == SDFT_NO_ERROR);
+    double dct_window[32] = {0};
+    my_complex dct_coefficients[32] = {{0, 0}}, dct_twiddles[64];
+    sdft_init_dct_from_buffers(inner, SDFT_DOUBLE, dct_window, dct_coefficients, dct_twiddles, window_size,
+            SDFT_DCT_II);
+    MU_ASSERT("cosine inner state accepted",
+            sdft_init_zoom(s, inner, center, factor, 8, taps, history) == SDFT_NOT_SUPPORTED);
+
+    free(inner);
+    free(s);
+
+    return 0;
+}
+
+struct recorded_output {
+    double values[64];
+    size_t n_elements;
+    unsigned long long n_samples;
+    size_t n_calls;
+};
+
+void record_output(void *user_data, const void *data, size_t n_elements, unsigned long long n_samples)
+{
+    struct recorded_output *out = user_data;
+    memcpy(out->values, data, n_elements * sizeof(double));
+    out->n_elements = n_elements;
+    out->n_samples = n_samples;
+    out->n_calls++;
+}
+
+char *test_pipeline()
+{
+    struct sdft_Stage stages[8];
+    size_t n_stages;
+    MU_ASSERT("unknown stage accepted",
+            sdft_parse_pipeline("gain 1 | fft 4", stages, 8, &n_stages) == SDFT_INVALID_PIPELINE);
+    MU_ASSERT("missing parameter accepted",
+            sdft_parse_pipeline("gain | sdft 4", stages, 8, &n_stages) == SDFT_INVALID_PIPELINE);
+    MU_ASSERT("too many stages accepted",
+            sdft_parse_pipeline("gain 1 | sdft 4 | power", stages, 2, &n_stages) == SDFT_INVALID_PIPELINE);
+    MU_ASSERT("infinite band edge accepted",
+            sdft_parse_pipeline("sdft 4 | bands 0 inf | sink 0", stages, 8, &n_stages) == SDFT_INVALID_PIPELINE);
+    MU_ASSERT("parsing failed", sdft_parse_pipeline(
+            " gain 0.5|sdft 3 | power | sink 0 | bands 0 1 5 | sink 1 ", stages, 8, &n_stages) == SDFT_NO_ERROR);
+    MU_ASSERT("wrong number of stages", n_stages == 6);
+    MU_ASSERT("wrong gain", stages[0].kind == SDFT_STAGE_GAIN && stages[0].parameter == 0.5);
+    MU_ASSERT("wrong bands", stages[4].kind == SDFT_STAGE_BANDS && stages[4].n_band_edges == 3
+            && stages[4].band_edges[2] == 5);
+
+    // a real signal as 16 bit stereo frames, of which the right channel is analyzed
+    const size_t window_size = 8, n_frames = 64;
+    short frames[2 * 64];
+    my_complex signal[64];
+    for (size_t i = 0; i < n_frames; ++i) {
+        frames[2 * i] = 0;
+        frames[2 * i + 1] = (short) (32767 * actual_signal[i]);
+        signal[i].real = 0.5 * frames[2 * i + 1] / 32768.0;
+        signal[i].imag = 0;
+    }
+
+    my_complex window_buffer[8] = {{0, 0}}, spec_buffer[8] = {{0, 0}}, phase_buffer[8];
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    sdft_init_from_buffers(s, SDFT_DOUBLE, window_buffer, spec_buffer, phase_buffer, window_size, SDFT_REAL_ONLY);
+
+    struct recorded_output power = {{0}, 0, 0, 0}, bands = {{0}, 0, 0, 0};
+    sdft_Sink sinks[2] = {&record_output, &record_output};
+    void *sink_data[2] = {&power, &bands};
+    struct sdft_Pipeline *pipeline = malloc(sdft_size_of_pipeline());
+    double *buffer = malloc(sdft_pipeline_buffer_size(s, stages, n_stages));
+
+    // the spectrum of a real signal only has 4 bins, so that the band edge 5 is out of range
+    MU_ASSERT("band out of range accepted", sdft_init_pipeline(pipeline, s, SDFT_PCM_S16, 2, 1, stages, n_stages,
+            sinks, sink_data, 2, buffer) == SDFT_INVALID_PIPELINE);
+    stages[4].band_edges[2] = 4;
+    MU_ASSERT("missing sink accepted", sdft_init_pipeline(pipeline, s, SDFT_PCM_S16, 2, 1, stages, n_stages,
+            sinks, sink_data, 1, buffer) == SDFT_INVALID_PIPELINE);
+    MU_ASSERT("pipeline init failed", sdft_init_pipeline(pipeline, s, SDFT_PCM_S16, 2, 1, stages, n_stages,
+            sinks, sink_data, 2, buffer) == SDFT_NO_ERROR);
+
+    // process in uneven blocks
+    MU_ASSERT("processing failed", sdft_pipeline_process(pipeline, frames, 5) == SDFT_NO_ERROR);
+    MU_ASSERT("processing failed", sdft_pipeline_process(pipeline, frames + 10, n_frames - 5) == SDFT_NO_ERROR);
+
+    MU_ASSERT("sinks not called once per hop", power.n_calls == n_frames / 3 && bands.n_calls == n_frames / 3);
+    MU_ASSERT("wrong sample count", power.n_samples == n_frames / 3 * 3);
+    MU_ASSERT("wrong number of elements", power.n_elements == 4 && bands.n_elements == 2);
+
+    my_complex expected[8];
+    dft(signal + power.n_samples - window_size, expected, window_size);
+    double expected_bands[2] = {0, 0};
+    for (size_t k = 0; k < 4; ++k) {
+        double abs = my_complex_abs(expected + k);
+        MU_ASSERT("power isn't equal to that of the dft", fabs(power.values[k] - abs * abs) < 1e-9);
+        expected_bands[k < 1 ? 0 : 1] += abs * abs;
+    }
+    for (size_t b = 0; b < 2; ++b) {
+        MU_ASSERT("band energy isn't equal to that of the dft", fabs(bands.values[b] - expected_bands[b]) < 1e-9);
+    }
+
+    // DC removal suppresses a constant signal
+    MU_ASSERT("parsing failed",
+            sdft_parse_pipeline("dc 0.9 | sdft 1 | power | sink 0", stages, 8, &n_stages) == SDFT_NO_ERROR);
+    free(buffer);
+    buffer = malloc(sdft_pipeline_buffer_size(s, stages, n_stages));
+    MU_ASSERT("pipeline init failed", sdft_init_pipeline(pipeline, s, SDFT_PCM_F64, 1, 0, stages, n_stages,
+            sinks, sink_data, 1, buffer) == SDFT_NO_ERROR);
+    double constant[256];
+    for (size_t i = 0; i < 256; ++i) {
+        constant[i] = 1;
+    }
+    MU_ASSERT("processing failed", sdft_pipeline_process(pipeline, constant, 256) == SDFT_NO_ERROR);
+    MU_ASSERT("dc not removed", power.values[0] < 1e-12);
+
+    // frames need not be aligned, e.g. when they follow a WAV header
+    unsigned char misaligned[1 + sizeof(constant)];
+    memcpy(misaligned + 1, constant, sizeof(constant));
+    MU_ASSERT("processing failed", sdft_pipeline_process(pipeline, misaligned + 1, 256) == SDFT_NO_ERROR);
+    MU_ASSERT("dc not removed", power.values[0] < 1e-12);
+
+    // neither an infinite hop size nor paired states, which take two samples per push
+    MU_ASSERT("parsing failed",
+            sdft_parse_pipeline("sdft inf | power | sink 0", stages, 8, &n_stages) == SDFT_NO_ERROR);
+    MU_ASSERT("infinite hop size accepted", sdft_init_pipeline(pipeline, s, SDFT_PCM_F64, 1, 0, stages, n_stages,
+            sinks, sink_data, 1, buffer) == SDFT_INVALID_HOP_SIZE);
+    MU_ASSERT("parsing failed",
+            sdft_parse_pipeline("sdft 1 | power | sink 0", stages, 8, &n_stages) == SDFT_NO_ERROR);
+    my_complex y_window[8] = {{0, 0}}, y_spec[8] = {{0, 0}}, y_phase[8], cross[8];
+    double autos[16];
+    struct sdft_State *y = malloc(sdft_size_of_state());
+    struct sdft_State *paired = malloc(sdft_size_of_state());
+    sdft_init_from_buffers(y, SDFT_DOUBLE, y_window, y_spec, y_phase, window_size, SDFT_REAL_ONLY);
+    MU_ASSERT("pairing failed", sdft_init_paired(paired, s, y, cross, autos, 0) == SDFT_NO_ERROR);
+    MU_ASSERT("paired state accepted", sdft_init_pipeline(pipeline, paired, SDFT_PCM_F64, 1, 0, stages, n_stages,
+            sinks, sink_data, 1, buffer) == SDFT_NOT_SUPPORTED);
+    free(paired);
+
+    // nor states which reject real samples
+    sdft_init_from_buffers(y, SDFT_DOUBLE, y_window, y_spec, y_phase, window_size, SDFT_IMAG_ONLY);
+    MU_ASSERT("imaginary state accepted", sdft_init_pipeline(pipeline, y, SDFT_PCM_F64, 1, 0, stages, n_stages,
+            sinks, sink_data, 1, buffer) == SDFT_NOT_SUPPORTED);
+    free(y);
+
+    // nor conditioning which turns the samples into NaN or makes the DC removal unstable
+    const char *invalid_conditioning[] = {"gain nan", "gain -inf", "dc inf", "dc 1", "dc -1.5"};
+    for (size_t i = 0; i < 5; ++i) {
+        char config[64];
+        snprintf(config, sizeof(config), "%s | sdft 1 | power | sink 0", invalid_conditioning[i]);
+        MU_ASSERT("parsing failed", sdft_parse_pipeline(config, stages, 8, &n_stages) == SDFT_NO_ERROR);
+        double *conditioning_buffer = malloc(sdft_pipeline_buffer_size(s, stages, n_stages));
+        MU_ASSERT("invalid conditioning accepted", sdft_init_pipeline(pipeline, s, SDFT_PCM_F64, 1, 0, stages,
+                n_stages, sinks, sink_data, 1, conditioning_buffer) == SDFT_INVALID_PIPELINE);
+        free(conditioning_buffer);
+    }
+
+    free(buffer);
+    free(pipeline);
+    free(s);
+
+    return 0;
+}
+
+char *test_latency_histogram()
+{
+    const size_t window_size = 16;
+    my_complex *window_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *spec_buffer = calloc(2 * window_size, sizeof(my_complex));
+    my_complex *phase_buffer = malloc(sizeof(my_complex) * 2 * window_size);
+    struct sdft_State *fst = malloc(sdft_size_of_state());
+    struct sdft_State *snd = malloc(sdft_size_of_state());
+    struct sdft_State *combined = malloc(sdft_size_of_state());
+    sdft_init_from_buffers(fst, SDFT_DOUBLE, window_buffer, spec_buffer, phase_buffer, window_size,
+            SDFT_REAL_AND_IMAG);
+    sdft_init_from_buffers(snd, SDFT_DOUBLE, window_buffer + window_size, spec_buffer + window_size,
+            phase_buffer + window_size, window_size, SDFT_REAL_AND_IMAG);
+    sdft_init_combine(combined, fst, snd);
+
+    struct sdft_LatencyHistogram *histograms = malloc(3 * sizeof(struct sdft_LatencyHistogram));
+    for (size_t i = 0; i < 3; ++i) {
+        sdft_reset_latency_histogram(histograms + i);
+    }
+    MU_ASSERT("sample interval 0 accepted", sdft_enable_latency_histogram(fst, histograms, 0) == SDFT_INVALID_HOP_SIZE);
+    MU_ASSERT("enabling failed", sdft_enable_latency_histogram(fst, histograms, 1) == SDFT_NO_ERROR);
+    MU_ASSERT("enabling failed", sdft_enable_latency_histogram(combined, histograms + 1, 4) == SDFT_NO_ERROR);
+
+    // fst on its own records every push, the combined state every fourth. Pushing into the combined state does not
+    // record the pushes into fst, which it wraps.
+    my_complex sample = {1, 2};
+    for (size_t i = 0; i < 100; ++i) {
+        sdft_push_next_sample(fst, &sample);
+    }
+    for (size_t i = 0; i < 100; ++i) {
+        sdft_push_next_sample(combined, &sample);
+    }
+    MU_ASSERT("wrong number of recorded latencies", histograms[0].total_count == 100);
+    MU_ASSERT("wrong number of recorded latencies", histograms[1].total_count == 25);
+    tests_run++;
+
+    for (size_t h = 0; h < 2; ++h) {
+        unsigned long long previous = 0;
+        for (double percentile = 0; percentile <= 100; percentile += 0.5) {
+            unsigned long long latency = sdft_get_latency_percentile(histograms + h, percentile);
+            MU_ASSERT("percentiles not monotonic", latency >= previous);
+            MU_ASSERT("percentile out of range", latency >= histograms[h].min && latency <= histograms[h].max);
+            previous = latency;
+        }
+        MU_ASSERT("wrong maximum", sdft_get_latency_percentile(histograms + h, 100) == histograms[h].max);
+        MU_ASSERT("invalid percentile accepted", sdft_get_latency_percentile(histograms + h, NAN) == 0
+                && sdft_get_latency_percentile(histograms + h, -1) == 0
+                && sdft_get_latency_percentile(histograms + h, 100.5) == 0
+                && sdft_get_latency_percentile(histograms + h, INFINITY) == 0);
+        tests_run++;
+    }
+
+    sdft_merge_latency_histograms(histograms + 2, histograms);
+    sdft_merge_latency_histograms(histograms + 2, histograms + 1);
+    MU_ASSERT("merge lost latencies", histograms[2].total_count == 125);
+    MU_ASSERT("merge lost the minimum", histograms[2].min == (histograms[0].min < histograms[1].min
+            ? histograms[0].min : histograms[1].min));
+    MU_ASSERT("merge lost the maximum", histograms[2].max == (histograms[0].max > histograms[1].max
+            ? histograms[0].max : histograms[1].max));
+    unsigned long long sum = 0;
+    for (size_t i = 0; i < SDFT_LATENCY_BUCKETS; ++i) {
+        MU_ASSERT("merge lost bucket counts",
+                histograms[2].counts[i] == histograms[0].counts[i] + histograms[1].counts[i]);
+        sum += histograms[2].counts[i];
+    }
+    MU_ASSERT("counts don't add up", sum == 125);
+    tests_run++;
+
+    sdft_reset_latency_histogram(histograms + 2);
+    MU_ASSERT("reset failed", histograms[2].total_count == 0 && sdft_get_latency_percentile(histograms + 2, 50) == 0);
+
+    // a zero-initialized histogram works without a reset, i.e. the minimum is taken from the recorded latencies
+    memset(histograms + 2, 0, sizeof(struct sdft_LatencyHistogram));
+    MU_ASSERT("enabling failed", sdft_enable_latency_histogram(fst, histograms + 2, 1) == SDFT_NO_ERROR);
+    for (size_t i = 0; i < 10; ++i) {
+        sdft_push_next_sample(fst, &sample);
+    }
+    MU_ASSERT("wrong number of recorded latencies", histograms[2].total_count == 10);
+    MU_ASSERT("minimum stuck at zero", histograms[2].min > 0 || histograms[2].counts[0] > 0);
+    MU_ASSERT("minimum above maximum", histograms[2].min <= histograms[2].max);
+    MU_ASSERT("no tick rate", sdft_get_latency_tick_rate() > 0);
+    tests_run++;
+
+    free(histograms);
+    free(fst);
+    free(snd);
+    free(combined);
+    free(window_buffer);
+    free(spec_buffer);
+    free(phase_buffer);
+
+    return 0;
+}
+
+char *flat_sdft(my_complex *signal, size_t signal_length, enum sdft_SignalTraits traits, size_t window_size,
+        enum sdft_FlatKind kind)
+{
+    size_t size = sdft_flat_size(SDFT_DOUBLE, window_size, kind);
+    struct sdft_FlatState *flat = malloc(size);
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    MU_ASSERT("flat init failed", sdft_init_flat(flat, SDFT_DOUBLE, window_size, traits, kind) == SDFT_NO_ERROR);
+    MU_ASSERT("wrong flat size", flat->size == size);
+    MU_ASSERT("flat handle init failed", sdft_init_from_flat(s, flat) == SDFT_NO_ERROR);
+
+    // Push the first half through one handle, then move the block and continue with a handle to the copy.
+    size_t half = signal_length / 2;
+    for (size_t i = 0; i < half; ++i) {
+        sdft_push_next_sample(s, signal + i);
+    }
+    struct sdft_FlatState *moved = malloc(size);
+    memcpy(moved, flat, size);
+    memset(flat, 0xFF, size);
+    MU_ASSERT("corrupted block accepted", sdft_init_from_flat(s, flat) == SDFT_INVALID_FLAT_STATE);
+    MU_ASSERT("flat handle init failed", sdft_init_from_flat(s, moved) == SDFT_NO_ERROR);
+
+    char *msg = compare_sdft_to_dft(s, signal + half, signal_length - half, traits, window_size);
+
+    free(s);
+    free(flat);
+    free(moved);
+
+    return msg;
+}
+
+char *test_flat_signal()
+{
+    // the mixed signal, twice
+    my_complex signal[] = {
+            {51, 0}, {2, 0}, {42, 5}, {0.2, 0.5},
+            {1, 0}, {765, 0}, {34, 0}, {2903, 0},
+            {4096, 256}, {0, 5334}, {3, 0}, {6, 0},
+            {4, 0}, {1, 0}, {0, 74}, {79, 74.5},
+            {51, 0}, {2, 0}, {42, 5}, {0.2, 0.5},
+            {1, 0}, {765, 0}, {34, 0}, {2903, 0},
+            {4096, 256}, {0, 5334}, {3, 0}, {6, 0},
+            {4, 0}, {1, 0}, {0, 74}, {79, 74.5}
+    };
+
+    char *msg;
+    for (size_t window_size = 1; window_size < 16; ++window_size) {
+        for (int kind = SDFT_FLAT_PLAIN; kind <= SDFT_FLAT_COMBINED; ++kind) {
+            if ((msg = flat_sdft(signal, 32, SDFT_REAL_AND_IMAG, window_size, (enum sdft_FlatKind) kind))) {
+                return msg;
+            }
+            tests_run++;
+        }
+    }
+
+    // the size of the block must not wrap around
+    size_t huge = (size_t) -1 / 64 + 1;
+    struct sdft_FlatState *flat = malloc(sdft_flat_size(SDFT_LONG_DOUBLE, 1, SDFT_FLAT_PLAIN));
+    MU_ASSERT("size of an oversized flat state", sdft_flat_size(SDFT_LONG_DOUBLE, huge, SDFT_FLAT_PLAIN) == 0);
+    MU_ASSERT("oversized flat state initialized", sdft_init_flat(flat, SDFT_LONG_DOUBLE, huge, SDFT_REAL_AND_IMAG,
+            SDFT_FLAT_PLAIN) == SDFT_NOT_SUPPORTED);
+    free(flat);
+    tests_run++;
+
+    return 0;
+}
+
+// Two states of sdft_init_from_buffers on one buffer of 6 * window_size zeros (the windows, the spectra and the phase
+// offsets of both), and optionally their combination, of which state is the one to push into.
+struct dft_fixture {
+    my_complex *buffers;
+    struct sdft_State *states[3];
+    struct sdft_State *state;
+};
+
+void init_dft_fixture(struct dft_fixture *f, size_t window_size, enum sdft_SignalTraits traits, int combine)
+{
+    f->buffers = calloc(6 * window_size, sizeof(my_complex));
+    for (size_t i = 0; i < 3; ++i) {
+        f->states[i] = malloc(sdft_size_of_state());
+    }
+    for (size_t i = 0; i < 2; ++i) {
+        sdft_init_from_buffers(f->states[i], SDFT_DOUBLE, f->buffers + i * window_size,
+                f->buffers + (2 + i) * window_size, f->buffers + (4 + i) * window_size, window_size, traits);
+    }
+    f->state = f->states[0];
+    if (combine) {
+        sdft_init_combine(f->states[2], f->states[0], f->states[1]);
+        f->state = f->states[2];
+    }
+}
+
+void free_dft_fixture(struct dft_fixture *f)
+{
+    for (size_t i = 0; i < 3; ++i) {
+        free(f->states[i]);
+    }
+    free(f->buffers);
+}
+
+char *silent_sdft(size_t window_size, enum sdft_SignalTraits traits, int combine, int lazy)
+{
+    // a signal repeating with the period of the window, so every push after the first window only rotates the
+    // spectrum, followed by silence and a few non-repeating samples
+    size_t signal_length = 5 * window_size + 7;
+    my_complex *signal = malloc(sizeof(my_complex) * signal_length);
+    for (size_t i = 0; i < signal_length; ++i) {
+        my_complex sample = {0, 0};
+        if (i < 3 * window_size) {
+            sample.real = (double) ((i % window_size) * 37 % 11) - 5;
+            sample.imag = traits == SDFT_REAL_ONLY ? 0 : (double) ((i % window_size) * 13 % 7);
+        } else if (i >= 5 * window_size) {
+            sample.real = (double) i;
+        }
+        signal[i] = sample;
+    }
+
+    struct dft_fixture fixture;
+    init_dft_fixture(&fixture, window_size, traits, combine);
+    struct sdft_State *s = fixture.state;
+    if (lazy) {
+        MU_ASSERT("enabling lazy rotation failed", sdft_enable_lazy_rotation(s, 1) == SDFT_NO_ERROR);
+    }
+    // without lazy rotation, the spectrum buffer of a plain state is up to date after every push
+    my_complex *kept_spec = sdft_get_spectrum(s);
+
+    // read the spectrum only now and then, so the rotations of several pushes pile up in between
+    my_complex *expected_spec = malloc(sizeof(my_complex) * window_size);
+    for (size_t i = 0; i < signal_length; ++i) {
+        sdft_push_next_sample(s, signal + i);
+        if (i + 1 < window_size || (i % 5 != 0 && i + 1 != signal_length)) {
+            continue;
+        }
+
+        dft(signal + i + 1 - window_size, expected_spec, window_size);
+        my_complex *actual_spec = lazy || combine ? sdft_get_spectrum(s) : kept_spec;
+        for (size_t k = 0; k < sdft_get_number_of_bins(s); ++k) {
+            my_complex delta = my_complex_sub(actual_spec + k, expected_spec + k);
+            MU_ASSERT("spectrum of a repeating signal isn't equal to that of the dft", my_complex_abs(&delta) < 0.001);
+        }
+    }
+
+    free_dft_fixture(&fixture);
+    free(expected_spec);
+    free(signal);
+
+    return 0;
+}
+
+char *test_silent_signal()
+{
+    char *msg;
+    for (size_t window_size = 1; window_size < 20; ++window_size) {
+        for (int traits = SDFT_REAL_AND_IMAG; traits <= SDFT_REAL_ONLY; ++traits) {
+            for (int combine = 0; combine < 2; ++combine) {
+                for (int lazy = 0; lazy < 2; ++lazy) {
+                    if ((msg = silent_sdft(window_size, (enum sdft_SignalTraits) traits, combine, lazy))) {
+                        return msg;
+                    }
+                    tests_run++;
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+char *skip_sdft(my_complex *signal, size_t signal_length, size_t window_size, size_t n_skipped, my_complex *fill,
+        enum sdft_SignalTraits traits, int combine)
+{
+    // the signal as it would have been pushed, with the skipped samples in the middle, after a window of the zeros
+    // the buffers start with
+    size_t half = signal_length / 2;
+    size_t length = window_size + signal_length + n_skipped;
+    my_complex *expected_signal = calloc(length, sizeof(my_complex));
+    memcpy(expected_signal + window_size, signal, half * sizeof(my_complex));
+    for (size_t i = 0; i < n_skipped; ++i) {
+        expected_signal[window_size + half + i] = fill ? *fill : my_complex_zero;
+    }
+    memcpy(expected_signal + window_size + half + n_skipped, signal + half, (signal_length - half) * sizeof(my_complex));
+
+    struct dft_fixture fixture;
+    init_dft_fixture(&fixture, window_size, traits, combine);
+    struct sdft_State *s = fixture.state;
+
+    for (size_t i = 0; i < half; ++i) {
+        sdft_push_next_sample(s, signal + i);
+    }
+    MU_ASSERT("skipping failed", sdft_skip_samples(s, n_skipped, fill) == SDFT_NO_ERROR);
+
+    // right after skipping
+    my_complex *expected_window = expected_signal + half + n_skipped;
+    my_complex *window = sdft_unshift_and_get_window(s);
+    my_complex *expected_spec = malloc(sizeof(my_complex) * window_size);
+    dft(expected_window, expected_spec, window_size);
+    my_complex *actual_spec = sdft_get_spectrum(s);
+    for (size_t i = 0; i < window_size; ++i) {
+        MU_ASSERT("window after skipping doesn't equal signal", my_complex_equal(window + i, expected_window + i));
+    }
+    for (size_t k = 0; k < sdft_get_number_of_bins(s); ++k) {
+        my_complex delta = my_complex_sub(actual_spec + k, expected_spec + k);
+        MU_ASSERT("spectrum after skipping isn't equal to that of the dft", my_complex_abs(&delta) < 0.001);
+    }
+    free(expected_spec);
+
+    // and after pushing the rest on top
+    char *msg = compare_sdft_to_dft(s, expected_signal + window_size + half + n_skipped, signal_length - half,
+            traits, window_size);
+
+    free_dft_fixture(&fixture);
+    free(expected_signal);
+
+    return msg;
+}
+
+char *test_skip_signal()
+{
+    my_complex signal[] = {
+            {51, 0}, {2, 0}, {42, 5}, {0.2, 0.5},
+            {1, 0}, {765, 0}, {34, 0}, {2903, 0},
+            {4096, 256}, {0, 5334}, {3, 0}, {6, 0},
+            {4, 0}, {1, 0}, {0, 74}, {79, 74.5},
+            {51, 0}, {2, 0}, {42, 5}, {0.2, 0.5},
+            {1, 0}, {765, 0}, {34, 0}, {2903, 0}
+    };
+    my_complex fill = {-3.5, 12};
+
+    // the same signal and fill without their imaginary parts
+    my_complex real_signal[24];
+    for (size_t i = 0; i < 24; ++i) {
+        real_signal[i].real = signal[i].real;
+        real_signal[i].imag = 0;
+    }
+    my_complex real_fill = {-3.5, 0};
+
+    char *msg;
+    for (size_t window_size = 1; window_size < 17; ++window_size) {
+        for (size_t n_skipped = 0; n_skipped < 3 * window_size + 2; ++n_skipped) {
+            for (int combine = 0; combine < 2; ++combine) {
+                if ((msg = skip_sdft(signal, 24, window_size, n_skipped, 0, SDFT_REAL_AND_IMAG, combine))
+                        || (msg = skip_sdft(signal, 24, window_size, n_skipped, &fill, SDFT_REAL_AND_IMAG, combine))
+                        || (msg = skip_sdft(real_signal, 24, window_size, n_skipped, 0, SDFT_REAL_ONLY, combine))
+                        || (msg = skip_sdft(real_signal, 24, window_size, n_skipped, &real_fill, SDFT_REAL_ONLY,
+                                combine))) {
+                    return msg;
+                }
+                tests_run++;
+            }
+        }
+    }
+
+    // the fill has to match the signal traits
+    my_complex window[4] = {{0, 0}}, spectrum[4] = {{0, 0}}, phase_offsets[4];
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    sdft_init_from_buffers(s, SDFT_DOUBLE, window, spectrum, phase_offsets, 4, SDFT_REAL_ONLY);
+    MU_ASSERT("fill violating the signal traits accepted",
+            sdft_skip_samples(s, 5, &fill) == SDFT_SIGNAL_TRAIT_VIOLATION);
+    free(s);
+    tests_run++;
+
+    return 0;
+}
+
+char *catch_up_sdft(size_t window_size, size_t block_length, enum sdft_SignalTraits traits, int combine)
+{
+    // a window of the zeros the buffers start with, a few pushed samples, the block and a window of samples on top
+    size_t n_pushed = window_size / 2 + 1;
+    size_t length = 2 * window_size + n_pushed + block_length;
+    my_complex *signal = calloc(length, sizeof(my_complex));
+    for (size_t i = window_size; i < length; ++i) {
+        double value = (double) (i * 7919 % 113) - 56;
+        signal[i].real = traits == SDFT_IMAG_ONLY ? 0 : value;
+        signal[i].imag = traits == SDFT_REAL_ONLY ? 0 : (double) (i * 31 % 17);
+    }
+
+    struct dft_fixture fixture;
+    init_dft_fixture(&fixture, window_size, traits, combine);
+    struct sdft_State *s = fixture.state;
+
+    for (size_t i = 0; i < n_pushed; ++i) {
+        sdft_push_next_sample(s, signal + window_size + i);
+    }
+    MU_ASSERT("catching up failed", sdft_catch_up(s, signal + window_size + n_pushed, block_length) == SDFT_NO_ERROR);
+
+    // right after the block
+    my_complex *expected_window = signal + n_pushed + block_length;
+    my_complex *window = sdft_unshift_and_get_window(s);
+    my_complex *expected_spec = malloc(sizeof(my_complex) * window_size);
+    dft(expected_window, expected_spec, window_size);
+    my_complex *actual_spec = sdft_get_spectrum(s);
+    size_t n_bins = traits == SDFT_REAL_AND_IMAG ? window_size : window_size / 2;
+    for (size_t i = 0; i < window_size; ++i) {
+        MU_ASSERT("window after catching up doesn't equal signal", my_complex_equal(window + i, expected_window + i));
+    }
+    for (size_t k = 0; k < n_bins; ++k) {
+        my_complex delta = my_complex_sub(actual_spec + k, expected_spec + k);
+        MU_ASSERT("spectrum after catching up isn't equal to that of the dft", my_complex_abs(&delta) < 0.001);
+    }
+    free(expected_spec);
+
+    // and after pushing a window on top
+    char *msg = compare_sdft_to_dft(s, signal + window_size + n_pushed + block_length, window_size, traits,
+            window_size);
+
+    free_dft_fixture(&fixture);
+    free(signal);
+
+    return msg;
+}
+
+char *test_catch_up_signal()
+{
+    char *msg;
+    for (size_t window_size = 1; window_size < 18; ++window_size) {
+        size_t block_lengths[] = {0, 1, window_size - 1, window_size, window_size + 1, 3 * window_size + 2, 1000};
+        for (size_t i = 0; i < sizeof(block_lengths) / sizeof(block_lengths[0]); ++i) {
+            for (int traits = SDFT_REAL_AND_IMAG; traits <= SDFT_IMAG_ONLY; ++traits) {
+                for (int combine = 0; combine < 2; ++combine) {
+                    if ((msg = catch_up_sdft(window_size, block_lengths[i], (enum sdft_SignalTraits) traits,
+                            combine))) {
+                        return msg;
+                    }
+                    tests_run++;
+                }
+            }
+        }
+    }
+
+    // a block violating the signal traits leaves the state as it was, even if it is combined, whichever of its
+    // sub-states is valid
+    const size_t window_size = 8;
+    const size_t pushes[] = {3, 10, 13, 20};
+    for (size_t p = 0; p < sizeof(pushes) / sizeof(pushes[0]); ++p) {
+        for (int combine = 0; combine < 2; ++combine) {
+            // a window of the zeros the buffers start with, the pushed samples and the block
+            my_complex signal[8 + 20 + 128];
+            for (size_t i = 0; i < 8 + 20 + 128; ++i) {
+                signal[i].real = i < window_size ? 0 : (double) (i * 7919 % 113) - 56;
+                signal[i].imag = 0;
+            }
+            struct dft_fixture fixture;
+            init_dft_fixture(&fixture, window_size, SDFT_REAL_ONLY, combine);
+            struct sdft_State *s = fixture.state;
+            for (size_t i = 0; i < pushes[p]; ++i) {
+                sdft_push_next_sample(s, signal + window_size + i);
+            }
+            my_complex *block = signal + window_size + pushes[p];
+            block[127].imag = 1;
+            MU_ASSERT("block violating the signal traits accepted",
+                    sdft_catch_up(s, block, 128) == SDFT_SIGNAL_TRAIT_VIOLATION);
+            block[127].imag = 0;
+
+            my_complex *expected_window = signal + pushes[p];
+            my_complex *window = sdft_unshift_and_get_window(s);
+            my_complex expected_spec[8];
+            dft(expected_window, expected_spec, window_size);
+            my_complex *actual_spec = sdft_get_spectrum(s);
+            for (size_t i = 0; i < window_size; ++i) {
+                MU_ASSERT("failed catch-up changed the window", my_complex_equal(window + i, expected_window + i));
+            }
+            for (size_t k = 0; k < sdft_get_number_of_bins(s); ++k) {
+                my_complex delta = my_complex_sub(actual_spec + k, expected_spec + k);
+                MU_ASSERT("failed catch-up changed the spectrum", my_complex_abs(&delta) < 0.001);
+            }
+            // and keeps working afterwards, i.e. the schedule of the combined state is intact, too
+            if ((msg = compare_sdft_to_dft(s, block, 3 * window_size, SDFT_REAL_ONLY, window_size))) {
+                return msg;
+            }
+            free_dft_fixture(&fixture);
+            tests_run++;
+        }
+    }
+
+    return 0;
+}
+
+char *resize_sdft(size_t window_size, size_t new_window_size, enum sdft_SignalTraits traits, int combine)
+{
+    // a window of the zeros the buffers start with, the samples pushed before resizing and a new window on top
+    size_t n_pushed = window_size + 3;
+    size_t length = new_window_size + n_pushed + new_window_size;
+    my_complex *signal = calloc(length, sizeof(my_complex));
+    for (size_t i = new_window_size; i < length; ++i) {
+        double value = (double) (i * 7919 % 113) - 56;
+        signal[i].real = traits == SDFT_IMAG_ONLY ? 0 : value;
+        signal[i].imag = traits == SDFT_REAL_ONLY ? 0 : (double) (i * 31 % 17);
+    }
+
+    struct dft_fixture fixture;
+    init_dft_fixture(&fixture, window_size, traits, combine);
+    struct sdft_State *s = fixture.state;
+    my_complex *new_buffers = calloc(6 * new_window_size, sizeof(my_complex));
+
+    for (size_t i = 0; i < n_pushed; ++i) {
+        sdft_push_next_sample(s, signal + new_window_size + i);
+    }
+    MU_ASSERT("resizing failed", sdft_resize(s, new_window_size, new_buffers, new_buffers + 2 * new_window_size,
+            new_buffers + 4 * new_window_size) == SDFT_NO_ERROR);
+    // the old buffers must not be used anymore
+    memset(fixture.buffers, 0xFF, 6 * window_size * sizeof(my_complex));
+
+    // the most recent samples, preceded by zeros if the window grew
+    my_complex *expected_window = calloc(new_window_size, sizeof(my_complex));
+    size_t n_kept = window_size < new_window_size ? window_size : new_window_size;
+    memcpy(expected_window + new_window_size - n_kept, signal + new_window_size + n_pushed - n_kept,
+            n_kept * sizeof(my_complex));
+    my_complex *window = sdft_unshift_and_get_window(s);
+    my_complex *expected_spec = malloc(sizeof(my_complex) * new_window_size);
+    dft(expected_window, expected_spec, new_window_size);
+    my_complex *actual_spec = sdft_get_spectrum(s);
+    MU_ASSERT("wrong number of bins after resizing", sdft_get_number_of_bins(s)
+            == (traits == SDFT_REAL_AND_IMAG ? new_window_size : new_window_size / 2));
+    for (size_t i = 0; i < new_window_size; ++i) {
+        MU_ASSERT("window after resizing doesn't hold the recent samples",
+                my_complex_equal(window + i, expected_window + i));
+    }
+    for (size_t k = 0; k < sdft_get_number_of_bins(s); ++k) {
+        my_complex delta = my_complex_sub(actual_spec + k, expected_spec + k);
+        MU_ASSERT("spectrum after resizing isn't equal to that of the dft", my_complex_abs(&delta) < 0.001);
+    }
+    free(expected_spec);
+    free(expected_window);
+
+    // and after pushing a new window on top
+    char *msg = compare_sdft_to_dft(s, signal + new_window_size + n_pushed, new_window_size, traits,
+            new_window_size);
+
+    free_dft_fixture(&fixture);
+    free(signal);
+    free(new_buffers);
+
+    return msg;
+}
+
+char *test_resize_signal()
+{
+    char *msg;
+    for (size_t window_size = 1; window_size < 12; ++window_size) {
+        for (size_t new_window_size = 1; new_window_size < 18; ++new_window_size) {
+            for (int traits = SDFT_REAL_AND_IMAG; traits <= SDFT_IMAG_ONLY; ++traits) {
+                for (int combine = 0; combine < 2; ++combine) {
+                    if ((msg = resize_sdft(window_size, new_window_size, (enum sdft_SignalTraits) traits, combine))) {
+                        return msg;
+                    }
+                    tests_run++;
+                }
+            }
+        }
+    }
+
+    // only states on the bins of the DFT can be resized
+    double bins[] = {0.5, 1.5};
+    my_complex window[4] = {{0, 0}}, spectrum[2] = {{0, 0}}, phase_offsets[4];
+    my_complex new_window[8], new_spectrum[8], new_phase_offsets[8];
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    sdft_init_from_bins(s, SDFT_DOUBLE, window, spectrum, phase_offsets, 4, SDFT_REAL_AND_IMAG, bins, 2);
+    MU_ASSERT("resizing a state on arbitrary bins accepted",
+            sdft_resize(s, 8, new_window, new_spectrum, new_phase_offsets) == SDFT_NOT_SUPPORTED);
+    free(s);
+    tests_run++;
+
+    return 0;
+}
+
+char *leaky_sdft(size_t window_size, double time_constant, enum sdft_SignalTraits traits)
+{
+    size_t length = 3 * window_size + 5;
+    my_complex *signal = malloc(length * sizeof(my_complex));
+    for (size_t i = 0; i < length; ++i) {
+        double value = (double) (i * 7919 % 113) - 56;
+        signal[i].real = traits == SDFT_IMAG_ONLY ? 0 : value;
+        signal[i].imag = traits == SDFT_REAL_ONLY ? 0 : (double) (i * 31 % 17);
+    }
+
+    my_complex *spectrum = malloc(window_size * sizeof(my_complex));
+    my_complex *poles = malloc(window_size * sizeof(my_complex));
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    MU_ASSERT("initializing a leaky state failed", sdft_init_leaky_from_buffers(s, SDFT_DOUBLE, spectrum, poles,
+            window_size, traits, time_constant) == SDFT_NO_ERROR);
+    MU_ASSERT("wrong number of bins of a leaky state", sdft_get_number_of_bins(s)
+            == (traits == SDFT_REAL_AND_IMAG ? window_size : window_size / 2));
+    MU_ASSERT("leaky state has a window", sdft_unshift_and_get_window(s) == 0);
+
+    for (size_t i = 0; i < length; ++i) {
+        sdft_push_next_sample(s, signal + i);
+    }
+
+    // the exponentially weighted sum over all samples, newest first
+    const double double_pi = 2 * 3.141592653589793238462643383279502884;
+    const double lambda = exp(-1 / time_constant);
+    my_complex *actual_spec = sdft_get_spectrum(s);
+    for (size_t k = 0; k < sdft_get_number_of_bins(s); ++k) {
+        my_complex expected = my_complex_zero;
+        double weight = 1;
+        for (size_t m = 0; m < length; ++m) {
+            weight *= lambda;
+            double angle = double_pi * k * (m + 1) / window_size;
+            my_complex tmp = {weight * cos(angle), weight * sin(angle)};
+            tmp = my_complex_mult(signal + length - 1 - m, &tmp);
+            expected = my_complex_add(&expected, &tmp);
+        }
+        my_complex delta = my_complex_sub(actual_spec + k, &expected);
+        MU_ASSERT("spectrum of leaky state isn't the exponentially weighted dft", my_complex_abs(&delta) < 0.001);
+    }
+
+    free(s);
+    free(poles);
+    free(spectrum);
+    free(signal);
+
+    return 0;
+}
+
+char *test_leaky_signal()
+{
+    char *msg;
+    const double time_constants[] = {0.5, 3, 40};
+    for (size_t window_size = 1; window_size < 12; ++window_size) {
+        for (size_t i = 0; i < 3; ++i) {
+            for (int traits = SDFT_REAL_AND_IMAG; traits <= SDFT_IMAG_ONLY; ++traits) {
+                if ((msg = leaky_sdft(window_size, time_constants[i], (enum sdft_SignalTraits) traits))) {
+                    return msg;
+                }
+                tests_run++;
+            }
+        }
+    }
+
+    my_complex spectrum[4], poles[4];
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    MU_ASSERT("leaky state without a time constant accepted", sdft_init_leaky_from_buffers(s, SDFT_DOUBLE, spectrum,
+            poles, 4, SDFT_REAL_AND_IMAG, 0) == SDFT_INVALID_TIME_CONSTANT);
+    MU_ASSERT("leaky state with a NaN time constant accepted", sdft_init_leaky_from_buffers(s, SDFT_DOUBLE, spectrum,
+            poles, 4, SDFT_REAL_AND_IMAG, nan("")) == SDFT_INVALID_TIME_CONSTANT);
+    MU_ASSERT("leaky state with an infinite time constant accepted", sdft_init_leaky_from_buffers(s, SDFT_DOUBLE,
+            spectrum, poles, 4, SDFT_REAL_AND_IMAG, INFINITY) == SDFT_INVALID_TIME_CONSTANT);
+    MU_ASSERT("leaky state without bins accepted", sdft_init_leaky_from_buffers(s, SDFT_DOUBLE, spectrum, poles, 0,
+            SDFT_REAL_AND_IMAG, 3) == SDFT_WINDOW_TOO_SHORT);
+    free(s);
+    tests_run++;
+
+    return 0;
+}
+
+#if defined(SDFT_HAVE_POOL) && defined(__linux__)
+
+char *test_pool()
+{
+    const size_t window_size = 8;
+    my_complex signal[] = {
+            {51, 0}, {2, 0}, {42, 5}, {0.2, 0.5},
+            {1, 0}, {765, 0}, {34, 0}, {2903, 0},
+            {4096, 256}, {0, 5334}, {3, 0}, {6, 0},
+            {4, 0}, {1, 0}, {0, 74}, {79, 74.5}
+    };
+
+    // the writer creates an anonymous pool, the reader maps it through the file descriptor
+    struct sdft_Pool *writer = malloc(sdft_size_of_pool());
+    struct sdft_Pool *reader = malloc(sdft_size_of_pool());
+    MU_ASSERT("pool creation failed", sdft_pool_create(writer, NULL, 3, SDFT_DOUBLE, window_size, SDFT_REAL_AND_IMAG,
+            SDFT_FLAT_COMBINED) == SDFT_NO_ERROR);
+    MU_ASSERT("pool open failed", sdft_pool_open_fd(reader, sdft_pool_get_fd(writer)) == SDFT_NO_ERROR);
+    MU_ASSERT("wrong number of states", sdft_pool_get_number_of_states(reader) == 3);
+    MU_ASSERT("state out of range", sdft_pool_get_state(reader, 3) == NULL);
+    tests_run++;
+
+    // receivers of the descriptor can neither write nor resize the pool
+    int fd = sdft_pool_get_fd(reader);
+    MU_ASSERT("pool mapped writable by a reader",
+            mmap(0, 64, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) == MAP_FAILED);
+    MU_ASSERT("pool resized by a reader", ftruncate(fd, 0) != 0);
+    tests_run++;
+
+    // the size of the pool must not wrap around
+    struct sdft_Pool *huge = malloc(sdft_size_of_pool());
+    MU_ASSERT("overflowing pool created", sdft_pool_create(huge, NULL, (size_t) -1 / 64, SDFT_DOUBLE, window_size,
+            SDFT_REAL_AND_IMAG, SDFT_FLAT_COMBINED) == SDFT_SYSTEM_ERROR && errno == EOVERFLOW);
+    MU_ASSERT("pool of oversized states created", sdft_pool_create(huge, NULL, 1, SDFT_LONG_DOUBLE,
+            (size_t) -1 / 64 + 1, SDFT_REAL_AND_IMAG, SDFT_FLAT_PLAIN) == SDFT_NOT_SUPPORTED);
+    free(huge);
+    tests_run++;
+
+    // readers don't follow a corrupted header out of the slot of its state
+    struct sdft_FlatState *corrupted = sdft_pool_get_state(writer, 0);
+    my_complex copy[8];
+    corrupted->window_size = 1000000;
+    MU_ASSERT("spectrum read beyond the slot", sdft_pool_read_spectrum(reader, 0, copy) == 0);
+    corrupted->window_size = window_size;
+    corrupted->spectra_offset = 1000000;
+    MU_ASSERT("spectrum read beyond the slot", sdft_pool_read_spectrum(reader, 0, copy) == 0);
+    corrupted->spectra_offset = sdft_pool_get_state(writer, 1)->spectra_offset;
+    MU_ASSERT("spectrum of a restored header not read", sdft_pool_read_spectrum(reader, 0, copy) == window_size);
+    tests_run++;
+
+    struct sdft_State *s = malloc(sdft_size_of_state());
+    MU_ASSERT("flat handle init failed", sdft_init_from_flat(s, sdft_pool_get_state(writer, 1)) == SDFT_NO_ERROR);
+    my_complex spectrum[8];
+    for (size_t i = 0; i < 16; ++i) {
+        sdft_pool_begin_write(writer, 1);
+        sdft_push_next_sample(s, signal + i);
+        sdft_pool_end_write(writer, 1);
+
+        MU_ASSERT("wrong number of bins", sdft_pool_read_spectrum(reader, 1, spectrum) == window_size);
+        my_complex *expected = sdft_get_spectrum(s);
+        for (size_t k = 0; k < window_size; ++k) {
+            MU_ASSERT("reader sees a different spectrum", my_complex_equal(spectrum + k, expected + k));
+        }
+        tests_run++;
+    }
+
+    // a read overlapping a write has to be retried, reads of other states are unaffected
+    unsigned long long token = sdft_pool_begin_read(reader, 1);
+    unsigned long long other_token = sdft_pool_begin_read(reader, 2);
+    sdft_pool_begin_write(writer, 1);
+    MU_ASSERT("overlapping read not detected", !sdft_pool_end_read(reader, 1, token));
+    MU_ASSERT("read of another state disturbed", sdft_pool_end_read(reader, 2, other_token));
+    sdft_pool_end_write(writer, 1);
+    token = sdft_pool_begin_read(reader, 1);
+    MU_ASSERT("consistent read not confirmed", sdft_pool_end_read(reader, 1, token));
+    tests_run++;
+
+    sdft_pool_close(reader);
+    sdft_pool_close(writer);
+    free(s);
+    free(reader);
+    free(writer);
+
+    return 0;
+}
+
+#endif
+
 char *test_suite(void)
 {
     MU_RUN_TESTS(test_mixed_signal);
     MU_RUN_TESTS(test_real_signal);
     MU_RUN_TESTS(test_imag_signal);
     MU_RUN_TESTS(test_actual_signal);
+    MU_RUN_TESTS(test_paired_signal);
+    MU_RUN_TESTS(test_averaged_signal);
+    MU_RUN_TESTS(test_cosine_signal);
+    MU_RUN_TESTS(test_goertzel_signal);
+    MU_RUN_TESTS(test_bins_signal);
+    MU_RUN_TESTS(test_constant_q_signal);
+    MU_RUN_TESTS(test_decimating_signal);
+    MU_RUN_TESTS(test_zoom_signal);
+    MU_RUN_TESTS(test_pipeline);
+    MU_RUN_TESTS(test_latency_histogram);
+    MU_RUN_TESTS(test_flat_signal);
+    MU_RUN_TESTS(test_silent_signal);
+    MU_RUN_TESTS(test_skip_signal);
+    MU_RUN_TESTS(test_catch_up_signal);
+    MU_RUN_TESTS(test_resize_signal);
+    MU_RUN_TESTS(test_leaky_signal);
+#if defined(SDFT_HAVE_POOL) && defined(__linux__)
+    MU_RUN_TESTS(test_pool);
+#endif
     return 0;
 }
 
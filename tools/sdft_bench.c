@@ -0,0 +1,826 @@
+// sdft_bench: measures the throughput and push latency of states over window sizes, precisions, signal traits and
+// simple vs. combined states, with separate or shared windows.
+//
+// For every configuration, the state is first fed a short warm-up, then timed over a run of pushes as a whole and
+// finally over a smaller run of individually timed pushes for the latency percentiles. Run with --help for the
+// options.
+//
+// With --soak, each state keeps running up to the given number of samples afterwards, and every --soak-interval
+// samples its spectrum is compared to a long double FFT (or, for window sizes which are not powers of two, a
+// compensated DFT) of sdft_unshift_and_get_window. This yields a curve of the numerical error over time for each
+// configuration, next to its throughput.
+//
+// With --perf (Linux only), hardware performance counters are sampled around the throughput run and reported per
+// sample and per bin, which helps telling compute-bound from bandwidth-bound window sizes.
+
+// syscall is needed for perf_event_open
+#define _GNU_SOURCE
+
+#include <getopt.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#ifdef __linux__
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#endif
+
+#include "sdft/sdft.h"
+
+// the number of individually timed pushes for the latency percentiles
+#define LATENCY_SAMPLES 4096
+
+// the number of hardware performance counters sampled with --perf
+#define N_PERF_EVENTS 6
+
+struct options {
+    size_t min_size;
+    size_t max_size;
+    size_t size_factor;
+    // the number of bin updates per configuration, which determines the number of pushes
+    double budget;
+    // bit sets of the precisions, signal traits and modes (see enum mode) to run
+    unsigned precisions;
+    unsigned traits;
+    unsigned modes;
+    int json;
+    // the total number of samples of the soak run and between its checkpoints, or 0 to skip it
+    double soak_samples;
+    double soak_interval;
+    int perf;
+};
+
+enum mode {
+    MODE_SIMPLE,
+    // sdft_init_combine on two states
+    MODE_COMBINED,
+    // sdft_init_shared_combined
+    MODE_SHARED
+};
+
+struct config {
+    size_t window_size;
+    enum sdft_FloatPrecision precision;
+    enum sdft_SignalTraits traits;
+    enum mode mode;
+};
+
+// a state under test together with its buffers
+struct bench_state {
+    struct sdft_State *states[3];
+    struct sdft_State *state;
+    void *buffers;
+    size_t n_bins;
+    size_t complex_size;
+    // a sample for each trait, of the precision of the state
+    long double sample[2];
+};
+
+// the error of the spectrum after n_samples pushes
+struct soak_point {
+    unsigned long long n_samples;
+    double max_error;
+    // the l2 norm of the error relative to that of the exact spectrum
+    double relative_error;
+};
+
+struct result {
+    size_t n_samples;
+    double ns_per_sample;
+    double bins_per_ns;
+    double gb_per_second;
+    double latency_ns[4];
+    struct soak_point *soak;
+    size_t n_soak_points;
+    double soak_ns_per_sample;
+    // the counts of the perf events during the throughput run, NAN if not available
+    double perf_counts[N_PERF_EVENTS];
+};
+
+//
+// Hardware performance counters
+//
+
+static const char *const perf_event_names[N_PERF_EVENTS] = {
+        "cycles", "instructions", "l1d_misses", "l2_misses", "llc_misses", "dtlb_misses"
+};
+
+// the file descriptors of the opened events, -1 for unavailable ones
+struct perf_counters {
+    int fds[N_PERF_EVENTS];
+};
+
+#ifdef __linux__
+
+static int open_perf_event(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    // the events are multiplexed if there are not enough hardware counters
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int) syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+static uint64_t cache_event(uint64_t cache)
+{
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+// Opens the events, returns 0 if none of them are available.
+static int open_perf_counters(struct perf_counters *c)
+{
+    c->fds[0] = open_perf_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    c->fds[1] = open_perf_event(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    c->fds[2] = open_perf_event(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_L1D));
+    // there is no generic L2 event, but the accesses of the last level cache are the requests which missed L2
+    c->fds[3] = open_perf_event(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+            | (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16));
+    c->fds[4] = open_perf_event(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_LL));
+    c->fds[5] = open_perf_event(PERF_TYPE_HW_CACHE, cache_event(PERF_COUNT_HW_CACHE_DTLB));
+
+    int any = 0;
+    for (size_t e = 0; e < N_PERF_EVENTS; ++e) {
+        any |= c->fds[e] >= 0;
+    }
+    return any;
+}
+
+static void start_perf_counters(struct perf_counters *c)
+{
+    for (size_t e = 0; e < N_PERF_EVENTS; ++e) {
+        if (c->fds[e] >= 0) {
+            ioctl(c->fds[e], PERF_EVENT_IOC_RESET, 0);
+            ioctl(c->fds[e], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+// Stops the events and stores their counts, scaled up for the time they were multiplexed out.
+static void stop_perf_counters(struct perf_counters *c, double *counts)
+{
+    for (size_t e = 0; e < N_PERF_EVENTS; ++e) {
+        uint64_t values[3];
+        counts[e] = NAN;
+        if (c->fds[e] >= 0) {
+            ioctl(c->fds[e], PERF_EVENT_IOC_DISABLE, 0);
+            if (read(c->fds[e], values, sizeof(values)) == sizeof(values) && values[2] > 0) {
+                counts[e] = (double) values[0] * values[1] / values[2];
+            }
+        }
+    }
+}
+
+static void close_perf_counters(struct perf_counters *c)
+{
+    for (size_t e = 0; e < N_PERF_EVENTS; ++e) {
+        if (c->fds[e] >= 0) {
+            close(c->fds[e]);
+        }
+    }
+}
+
+#else
+
+static int open_perf_counters(struct perf_counters *c)
+{
+    for (size_t e = 0; e < N_PERF_EVENTS; ++e) {
+        c->fds[e] = -1;
+    }
+    return 0;
+}
+
+static void start_perf_counters(struct perf_counters *c)
+{
+    (void) c;
+}
+
+static void stop_perf_counters(struct perf_counters *c, double *counts)
+{
+    (void) c;
+    for (size_t e = 0; e < N_PERF_EVENTS; ++e) {
+        counts[e] = NAN;
+    }
+}
+
+static void close_perf_counters(struct perf_counters *c)
+{
+    (void) c;
+}
+
+#endif
+
+static const char *const precision_names[] = {"single", "double", "long"};
+static const char *const traits_names[] = {"mixed", "real", "imag"};
+static const char *const mode_names[] = {"simple", "combined", "shared"};
+static const double percentiles[] = {0.5, 0.99, 0.999, 1.0};
+static const char *const percentile_names[] = {"p50", "p99", "p999", "max"};
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "\n"
+            "  -m, --min-size N      the smallest window size (default: 8)\n"
+            "  -M, --max-size N      the largest window size (default: 16777216)\n"
+            "  -f, --factor F        the factor between consecutive window sizes (default: 8)\n"
+            "  -b, --budget B        the number of bin updates per configuration (default: 1e8)\n"
+            "  -p, --precision P     single, double, long or all (default: all)\n"
+            "  -t, --traits T        mixed, real, imag or all (default: all)\n"
+            "  -c, --mode M          simple, combined, shared or all (default: all)\n"
+            "  -j, --json            write the results as a JSON array to stdout\n"
+            "  -s, --soak S          keep each state running up to S samples and track its error (default: off)\n"
+            "  -i, --soak-interval I the number of samples between error checks of the soak run (default: S / 32)\n"
+            "                        The reference is an FFT for window sizes which are powers of two, otherwise a\n"
+            "                        DFT, so other window sizes above 4096 are not soaked.\n"
+            "  -P, --perf            sample hardware performance counters around the throughput run (Linux only)\n",
+            name);
+}
+
+// Parses one of names or "all" into a bit set.
+static unsigned parse_set(const char *arg, const char *const *names, size_t n_names)
+{
+    if (!strcmp(arg, "all")) {
+        return (1u << n_names) - 1;
+    }
+    for (size_t i = 0; i < n_names; ++i) {
+        if (!strcmp(arg, names[i])) {
+            return 1u << i;
+        }
+    }
+
+    return 0;
+}
+
+static int parse_options(int argc, char **argv, struct options *o)
+{
+    static const struct option long_options[] = {
+            {"min-size",      required_argument, 0, 'm'},
+            {"max-size",      required_argument, 0, 'M'},
+            {"factor",        required_argument, 0, 'f'},
+            {"budget",        required_argument, 0, 'b'},
+            {"precision",     required_argument, 0, 'p'},
+            {"traits",        required_argument, 0, 't'},
+            {"mode",          required_argument, 0, 'c'},
+            {"json",          no_argument,       0, 'j'},
+            {"soak",          required_argument, 0, 's'},
+            {"soak-interval", required_argument, 0, 'i'},
+            {"perf",          no_argument,       0, 'P'},
+            {0, 0, 0, 0}
+    };
+
+    o->min_size = 8;
+    o->max_size = 16777216;
+    o->size_factor = 8;
+    o->budget = 1e8;
+    o->precisions = 7;
+    o->traits = 7;
+    o->modes = 7;
+    o->json = 0;
+    o->soak_samples = 0;
+    o->soak_interval = 0;
+    o->perf = 0;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "m:M:f:b:p:t:c:js:i:P", long_options, 0)) != -1) {
+        switch (c) {
+            case 'm':
+                o->min_size = strtoul(optarg, 0, 10);
+                break;
+            case 'M':
+                o->max_size = strtoul(optarg, 0, 10);
+                break;
+            case 'f':
+                o->size_factor = strtoul(optarg, 0, 10);
+                break;
+            case 'b':
+                o->budget = strtod(optarg, 0);
+                break;
+            case 'p':
+                o->precisions = parse_set(optarg, precision_names, 3);
+                break;
+            case 't':
+                o->traits = parse_set(optarg, traits_names, 3);
+                break;
+            case 'c':
+                o->modes = parse_set(optarg, mode_names, 3);
+                break;
+            case 'j':
+                o->json = 1;
+                break;
+            case 's':
+                o->soak_samples = strtod(optarg, 0);
+                break;
+            case 'i':
+                o->soak_interval = strtod(optarg, 0);
+                break;
+            case 'P':
+                o->perf = 1;
+                break;
+            default:
+                return 0;
+        }
+    }
+
+    if (o->soak_interval <= 0) {
+        o->soak_interval = o->soak_samples / 32;
+    }
+
+    return optind == argc && o->min_size >= 1 && o->size_factor >= 2 && o->budget > 0 && o->precisions
+           && o->traits && o->modes && o->soak_samples >= 0 && (o->soak_samples == 0 || o->soak_interval >= 1);
+}
+
+static double now_ns()
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+//
+// States under test
+//
+
+static size_t size_of_float(enum sdft_FloatPrecision precision)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            return sizeof(float);
+        case SDFT_DOUBLE:
+            return sizeof(double);
+        default:
+            return sizeof(long double);
+    }
+}
+
+// Stores the complex number (re, im) with the given precision at dst.
+static void store_complex(void *dst, long double re, long double im, enum sdft_FloatPrecision precision)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            ((float *) dst)[0] = (float) re;
+            ((float *) dst)[1] = (float) im;
+            break;
+        case SDFT_DOUBLE:
+            ((double *) dst)[0] = (double) re;
+            ((double *) dst)[1] = (double) im;
+            break;
+        default:
+            ((long double *) dst)[0] = re;
+            ((long double *) dst)[1] = im;
+            break;
+    }
+}
+
+static void free_bench_state(struct bench_state *b)
+{
+    for (size_t i = 0; i < 3; ++i) {
+        free(b->states[i]);
+    }
+    free(b->buffers);
+}
+
+// Allocates and initializes the state(s) of config. Returns NULL, or an error message after freeing what was allocated.
+static const char *init_bench_state(struct bench_state *b, const struct config *config)
+{
+    memset(b, 0, sizeof(*b));
+    size_t n_states = config->mode == MODE_COMBINED ? 2 : 1;
+    size_t n = config->window_size;
+    b->complex_size = 2 * size_of_float(config->precision);
+
+    // the window, spectrum and phase offsets of each state, or the window, both spectra and the phase offsets
+    b->buffers = calloc((config->mode == MODE_SHARED ? 4 : 3) * n_states * n, b->complex_size);
+    if (!b->buffers) {
+        return "out of memory";
+    }
+    for (size_t i = 0; i < 3; ++i) {
+        b->states[i] = malloc(sdft_size_of_state());
+        if (!b->states[i]) {
+            free_bench_state(b);
+            return "out of memory";
+        }
+    }
+    enum sdft_Error err = SDFT_NO_ERROR;
+    if (config->mode == MODE_SHARED) {
+        char *buffers = b->buffers;
+        err = sdft_init_shared_combined(b->states[0], config->precision, buffers, buffers + n * b->complex_size,
+                buffers + 3 * n * b->complex_size, n, config->traits);
+        n_states = 0;
+    }
+    for (size_t i = 0; i < n_states && err == SDFT_NO_ERROR; ++i) {
+        char *buffers = (char *) b->buffers + 3 * i * n * b->complex_size;
+        err = sdft_init_from_buffers(b->states[i], config->precision, buffers, buffers + n * b->complex_size,
+                buffers + 2 * n * b->complex_size, n, config->traits);
+    }
+    b->state = b->states[0];
+    if (config->mode == MODE_COMBINED && err == SDFT_NO_ERROR) {
+        err = sdft_init_combine(b->states[2], b->states[0], b->states[1]);
+        b->state = b->states[2];
+    }
+    if (err != SDFT_NO_ERROR) {
+        free_bench_state(b);
+        return "the state could not be initialized";
+    }
+    b->n_bins = sdft_get_number_of_bins(b->state);
+
+    return 0;
+}
+
+// Returns the real part of the i-th element of the complex numbers of the given precision at src.
+static long double load_real(const void *src, size_t i, enum sdft_FloatPrecision precision)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            return ((const float *) src)[2 * i];
+        case SDFT_DOUBLE:
+            return ((const double *) src)[2 * i];
+        default:
+            return ((const long double *) src)[2 * i];
+    }
+}
+
+// Pushes the i-th sample of a deterministic test signal which satisfies the signal traits of config.
+static void push(struct bench_state *b, const struct config *config, size_t i)
+{
+    // a cheap, non-periodic signal in [-1, 1]
+    long double x = (long double) ((i * 2654435761u) & 0xFFFF) / 32768 - 1;
+    long double re = config->traits == SDFT_IMAG_ONLY ? 0 : x;
+    long double im = config->traits == SDFT_REAL_ONLY ? 0 : -x;
+    store_complex(b->sample, re, im, config->precision);
+    sdft_push_next_sample(b->state, b->sample);
+}
+
+//
+// Measurements
+//
+
+static int compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+    return (x > y) - (x < y);
+}
+
+// Adds x to the compensated sum (sum, compensation).
+static void kahan_add(long double *sum, long double *compensation, long double x)
+{
+    long double y = x - *compensation;
+    long double t = *sum + y;
+    *compensation = (t - *sum) - y;
+    *sum = t;
+}
+
+// The largest window size which is not a power of two and still gets a soak run, as its reference is a DFT.
+#define MAX_SOAK_DFT_SIZE 4096
+
+static int is_power_of_two(size_t n)
+{
+    return n > 0 && (n & (n - 1)) == 0;
+}
+
+// Computes the reference spectrum of the window of the state into reference (2 * N long doubles), with exact twiddle
+// indices. twiddles holds e^{-2 pi i m / N} for all m. Powers of two get a radix-2 FFT, whose error only grows with
+// log(N), other window sizes a compensated DFT.
+static void reference_spectrum(struct bench_state *b, const struct config *config, const long double *twiddles,
+        long double *reference)
+{
+    size_t n = config->window_size;
+    const void *window = sdft_unshift_and_get_window(b->state);
+
+    if (!is_power_of_two(n)) {
+        for (size_t k = 0; k < b->n_bins; ++k) {
+            long double re = 0, im = 0, re_compensation = 0, im_compensation = 0;
+            for (size_t j = 0; j < n; ++j) {
+                size_t m = (k * j) % n;
+                long double x_re = load_real(window, j, config->precision);
+                long double x_im = load_real((const char *) window + b->complex_size / 2, j, config->precision);
+                kahan_add(&re, &re_compensation, x_re * twiddles[2 * m] - x_im * twiddles[2 * m + 1]);
+                kahan_add(&im, &im_compensation, x_re * twiddles[2 * m + 1] + x_im * twiddles[2 * m]);
+            }
+            reference[2 * k] = re;
+            reference[2 * k + 1] = im;
+        }
+        return;
+    }
+
+    // the window in bit-reversed order
+    size_t bits = 0;
+    while (((size_t) 1 << bits) < n) {
+        ++bits;
+    }
+    for (size_t j = 0; j < n; ++j) {
+        size_t r = 0;
+        for (size_t bit = 0; bit < bits; ++bit) {
+            r |= ((j >> bit) & 1) << (bits - 1 - bit);
+        }
+        reference[2 * r] = load_real(window, j, config->precision);
+        reference[2 * r + 1] = load_real((const char *) window + b->complex_size / 2, j, config->precision);
+    }
+
+    for (size_t length = 2; length <= n; length *= 2) {
+        size_t stride = n / length;
+        for (size_t start = 0; start < n; start += length) {
+            for (size_t j = 0; j < length / 2; ++j) {
+                long double w_re = twiddles[2 * j * stride], w_im = twiddles[2 * j * stride + 1];
+                long double *u = reference + 2 * (start + j);
+                long double *v = reference + 2 * (start + j + length / 2);
+                long double t_re = v[0] * w_re - v[1] * w_im;
+                long double t_im = v[0] * w_im + v[1] * w_re;
+                v[0] = u[0] - t_re;
+                v[1] = u[1] - t_im;
+                u[0] += t_re;
+                u[1] += t_im;
+            }
+        }
+    }
+}
+
+// Compares the spectrum of the state to the reference spectrum of its window, see reference_spectrum.
+static void check_spectrum(struct bench_state *b, const struct config *config, const long double *twiddles,
+        long double *reference, struct soak_point *point)
+{
+    reference_spectrum(b, config, twiddles, reference);
+    const void *spectrum = sdft_get_spectrum(b->state);
+
+    double max_error = 0;
+    long double error_norm = 0, norm = 0;
+    for (size_t k = 0; k < b->n_bins; ++k) {
+        long double re = reference[2 * k], im = reference[2 * k + 1];
+        long double d_re = load_real(spectrum, k, config->precision) - re;
+        long double d_im = load_real((const char *) spectrum + b->complex_size / 2, k, config->precision) - im;
+        long double error = d_re * d_re + d_im * d_im;
+        if (sqrtl(error) > max_error) {
+            max_error = (double) sqrtl(error);
+        }
+        error_norm += error;
+        norm += re * re + im * im;
+    }
+
+    point->max_error = max_error;
+    point->relative_error = norm > 0 ? (double) sqrtl(error_norm / norm) : (double) sqrtl(error_norm);
+}
+
+// Continues to push samples into the state up to the soak length, checking its spectrum every soak interval.
+static void soak(const struct options *o, const struct config *config, struct bench_state *b, struct result *r,
+        size_t i)
+{
+    size_t n = config->window_size;
+    long double *twiddles = malloc(2 * n * sizeof(long double));
+    long double *reference = malloc(2 * n * sizeof(long double));
+    const long double two_pi = 6.283185307179586476925286766559005768L;
+    for (size_t m = 0; m < n; ++m) {
+        twiddles[2 * m] = cosl(two_pi * m / n);
+        twiddles[2 * m + 1] = -sinl(two_pi * m / n);
+    }
+
+    // the first checkpoint is right after the throughput and latency runs
+    size_t soak_samples = (size_t) o->soak_samples;
+    size_t interval = (size_t) o->soak_interval;
+    size_t n_checks = 1 + (i < soak_samples ? (soak_samples - i + interval - 1) / interval : 0);
+    r->soak = malloc(n_checks * sizeof(struct soak_point));
+    double elapsed = 0;
+    size_t n_pushed = 0;
+    for (r->n_soak_points = 0; r->n_soak_points < n_checks; ++r->n_soak_points) {
+        size_t end = r->n_soak_points == 0 ? i : i + interval < soak_samples ? i + interval : soak_samples;
+        double start = now_ns();
+        for (; i < end; ++i, ++n_pushed) {
+            push(b, config, i);
+        }
+        elapsed += now_ns() - start;
+
+        r->soak[r->n_soak_points].n_samples = i;
+        check_spectrum(b, config, twiddles, reference, r->soak + r->n_soak_points);
+    }
+    r->soak_ns_per_sample = n_pushed ? elapsed / n_pushed : 0;
+
+    free(reference);
+    free(twiddles);
+}
+
+static void run(const struct options *o, const struct config *config, struct bench_state *b,
+        struct perf_counters *counters, struct result *r)
+{
+    size_t n_samples = (size_t) (o->budget / b->n_bins);
+    if (n_samples < 16) {
+        n_samples = 16;
+    }
+    size_t i = 0;
+
+    // warm-up, which also faults in the pages of the buffers
+    for (size_t end = i + n_samples / 8 + 1; i < end; ++i) {
+        push(b, config, i);
+    }
+
+    // throughput
+    if (counters) {
+        start_perf_counters(counters);
+    }
+    double start = now_ns();
+    for (size_t end = i + n_samples; i < end; ++i) {
+        push(b, config, i);
+    }
+    double elapsed = now_ns() - start;
+    if (counters) {
+        stop_perf_counters(counters, r->perf_counts);
+    }
+
+    r->n_samples = n_samples;
+    r->ns_per_sample = elapsed / n_samples;
+    r->bins_per_ns = (double) b->n_bins * n_samples / elapsed;
+    // each push reads the phase offset and reads and writes the spectrum of each bin of each state, a shared combined
+    // state reads the phase offset only once
+    const double accesses_per_bin[] = {3, 6, 5};
+    r->gb_per_second = accesses_per_bin[config->mode] * b->n_bins * b->complex_size * n_samples / elapsed;
+
+    // latency
+    size_t n_latencies = n_samples < LATENCY_SAMPLES ? n_samples : LATENCY_SAMPLES;
+    double *latencies = malloc(n_latencies * sizeof(double));
+    for (size_t k = 0; k < n_latencies; ++k, ++i) {
+        double t = now_ns();
+        push(b, config, i);
+        latencies[k] = now_ns() - t;
+    }
+    qsort(latencies, n_latencies, sizeof(double), &compare_doubles);
+    for (size_t p = 0; p < 4; ++p) {
+        size_t k = (size_t) (percentiles[p] * (n_latencies - 1) + 0.5);
+        r->latency_ns[p] = latencies[k];
+    }
+    free(latencies);
+
+    r->soak = 0;
+    r->n_soak_points = 0;
+    // the DFT reference of window sizes which are not powers of two is too slow for large ones
+    if (o->soak_samples > 0 && (is_power_of_two(config->window_size) || config->window_size <= MAX_SOAK_DFT_SIZE)) {
+        soak(o, config, b, r, i);
+    }
+}
+
+//
+// Reporting
+//
+
+static void print_header(const struct options *o)
+{
+    if (o->json) {
+        printf("[");
+        return;
+    }
+
+    printf("%10s %-7s %-6s %-9s %10s %10s %10s %8s", "size", "prec", "traits", "mode", "samples", "ns/sample",
+           "bins/ns", "GB/s");
+    for (size_t p = 0; p < 4; ++p) {
+        printf(" %9s", percentile_names[p]);
+    }
+    printf("\n");
+}
+
+static void print_soak(const struct options *o, const struct result *r)
+{
+    if (o->json) {
+        printf(", \"soak_ns_per_sample\": %.4g, \"soak\": [", r->soak_ns_per_sample);
+        for (size_t p = 0; p < r->n_soak_points; ++p) {
+            printf("%s{\"samples\": %llu, \"max_error\": %.4g, \"relative_error\": %.4g}", p ? ", " : "",
+                   r->soak[p].n_samples, r->soak[p].max_error, r->soak[p].relative_error);
+        }
+        printf("]");
+        return;
+    }
+
+    printf("%10s soak: %.4g ns/sample\n%10s %20s %12s %14s\n", "", r->soak_ns_per_sample, "", "samples",
+           "max error", "relative error");
+    for (size_t p = 0; p < r->n_soak_points; ++p) {
+        printf("%10s %20llu %12.4g %14.4g\n", "", r->soak[p].n_samples, r->soak[p].max_error,
+               r->soak[p].relative_error);
+    }
+}
+
+static void print_perf(const struct options *o, const struct result *r, const struct config *config)
+{
+    double n_samples = (double) r->n_samples;
+    double n_bins = n_samples * (config->traits == SDFT_REAL_AND_IMAG ? config->window_size : config->window_size / 2);
+
+    if (o->json) {
+        printf(", \"perf\": {");
+        for (size_t e = 0; e < N_PERF_EVENTS; ++e) {
+            if (isnan(r->perf_counts[e])) {
+                printf("%s\"%s\": null", e ? ", " : "", perf_event_names[e]);
+            } else {
+                printf("%s\"%s\": {\"per_sample\": %.4g, \"per_bin\": %.4g}", e ? ", " : "", perf_event_names[e],
+                       r->perf_counts[e] / n_samples, r->perf_counts[e] / n_bins);
+            }
+        }
+        printf("}");
+        return;
+    }
+
+    printf("%10s perf %14s %12s\n", "", "per sample", "per bin");
+    for (size_t e = 0; e < N_PERF_EVENTS; ++e) {
+        printf("%10s %-12s %8.4g %12.4g\n", "", perf_event_names[e], r->perf_counts[e] / n_samples,
+               r->perf_counts[e] / n_bins);
+    }
+}
+
+static void print_result(const struct options *o, const struct config *config, const struct result *r, int first)
+{
+    if (o->json) {
+        printf("%s\n  {\"window_size\": %zu, \"precision\": \"%s\", \"traits\": \"%s\", \"mode\": \"%s\", "
+               "\"samples\": %zu, \"ns_per_sample\": %.4g, \"bins_per_ns\": %.4g, \"gb_per_second\": %.4g, "
+               "\"latency_ns\": {", first ? "" : ",", config->window_size, precision_names[config->precision],
+               traits_names[config->traits], mode_names[config->mode], r->n_samples, r->ns_per_sample,
+               r->bins_per_ns, r->gb_per_second);
+        for (size_t p = 0; p < 4; ++p) {
+            printf("%s\"%s\": %.4g", p ? ", " : "", percentile_names[p], r->latency_ns[p]);
+        }
+        printf("}");
+        if (r->n_soak_points) {
+            print_soak(o, r);
+        }
+        if (o->perf) {
+            print_perf(o, r, config);
+        }
+        printf("}");
+        return;
+    }
+
+    printf("%10zu %-7s %-6s %-9s %10zu %10.4g %10.4g %8.4g", config->window_size,
+           precision_names[config->precision], traits_names[config->traits], mode_names[config->mode],
+           r->n_samples, r->ns_per_sample, r->bins_per_ns, r->gb_per_second);
+    for (size_t p = 0; p < 4; ++p) {
+        printf(" %9.4g", r->latency_ns[p]);
+    }
+    printf("\n");
+    if (o->perf) {
+        print_perf(o, r, config);
+    }
+    if (r->n_soak_points) {
+        print_soak(o, r);
+    }
+}
+
+static void print_footer(const struct options *o)
+{
+    if (o->json) {
+        printf("\n]\n");
+    }
+}
+
+int main(int argc, char **argv)
+{
+    struct options o;
+    if (!parse_options(argc, argv, &o)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct perf_counters counters;
+    if (o.perf && !open_perf_counters(&counters)) {
+        fprintf(stderr, "hardware performance counters are not available\n");
+    }
+
+    print_header(&o);
+    int first = 1;
+    for (size_t n = o.min_size; n <= o.max_size; n *= o.size_factor) {
+        for (unsigned p = 0; p < 3; ++p) {
+            for (unsigned t = 0; t < 3; ++t) {
+                for (unsigned m = 0; m < 3; ++m) {
+                    if (!(o.precisions & (1u << p)) || !(o.traits & (1u << t)) || !(o.modes & (1u << m))) {
+                        continue;
+                    }
+                    struct config config = {n, (enum sdft_FloatPrecision) p, (enum sdft_SignalTraits) t, (enum mode) m};
+                    struct bench_state b;
+                    const char *error = init_bench_state(&b, &config);
+                    if (error) {
+                        fprintf(stderr, "skipping window size %zu: %s\n", n, error);
+                        continue;
+                    }
+                    struct result r;
+                    run(&o, &config, &b, o.perf ? &counters : 0, &r);
+                    print_result(&o, &config, &r, first);
+                    fflush(stdout);
+                    free(r.soak);
+                    first = 0;
+                    free_bench_state(&b);
+                }
+            }
+        }
+    }
+    print_footer(&o);
+    if (o.perf) {
+        close_perf_counters(&counters);
+    }
+
+    return 0;
+}
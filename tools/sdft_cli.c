@@ -0,0 +1,597 @@
+// sdft-cli: streams a WAV or raw PCM file through a sdft pipeline and writes spectra, power spectra or band energies.
+//
+// The input file is memory-mapped and processed in blocks directly from the mapping, so arbitrarily large captures
+// can be processed without reading them into memory. Run without arguments for usage information.
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sdft/sdft.h"
+#include "sdft/sdft_pipeline.h"
+
+#ifdef SDFT_HAVE_URING
+#include "uring_source.h"
+#endif
+
+// the number of frames handed to sdft_pipeline_process at once
+#define BLOCK_FRAMES 65536
+
+// the number of blocks read ahead with --uring
+#define URING_BLOCKS 8
+
+enum output_kind {
+    OUTPUT_SPECTRUM,
+    OUTPUT_POWER,
+    OUTPUT_BANDS
+};
+
+struct options {
+    const char *input;
+    const char *output;
+    // -1 to detect from the file name
+    int format;
+    size_t n_channels;
+    size_t channel;
+    size_t window_size;
+    enum sdft_FloatPrecision precision;
+    enum sdft_SignalTraits traits;
+    size_t hop_size;
+    int combined;
+    enum output_kind output_kind;
+    const char *bands;
+    int binary;
+    double gain;
+    double dc_pole;
+    int uring;
+};
+
+struct input {
+    void *mapping;
+    size_t mapping_size;
+    const unsigned char *frames;
+    size_t n_frames;
+    enum sdft_SampleFormat format;
+    size_t n_channels;
+};
+
+struct writer {
+    FILE *file;
+    int binary;
+    // whether the data are complex numbers of the given precision instead of doubles
+    int complex;
+    enum sdft_FloatPrecision precision;
+};
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] input [output]\n"
+            "\n"
+            "Streams a WAV or raw PCM file through a sliding DFT and writes one line (CSV) or record (binary)\n"
+            "per hop to output (default: stdout). Throughput is reported on stderr.\n"
+            "\n"
+            "  -f, --format FMT      wav, s16, s32, f32 or f64 (default: wav for *.wav, s16 otherwise)\n"
+            "  -c, --channels N      number of interleaved channels of raw input (default: 1)\n"
+            "  -C, --channel I       the channel to analyze (default: 0)\n"
+            "  -n, --window-size N   window size of the sdft (default: 1024)\n"
+            "  -p, --precision P     single, double or long (default: double)\n"
+            "  -t, --traits T        real or mixed (default: real)\n"
+            "  -H, --hop H           number of samples between outputs (default: window size)\n"
+            "  -s, --combined        use a combined state for numerical stability\n"
+            "  -o, --output KIND     spectrum, power or bands (default: power)\n"
+            "  -b, --bands EDGES     comma separated band edges in bins, implies --output bands\n"
+            "  -B, --binary          write native binary records instead of CSV\n"
+            "  -g, --gain G          multiply the samples by G\n"
+            "  -d, --dc POLE         remove the DC offset with a filter with the given pole, e.g. 0.995\n"
+#ifdef SDFT_HAVE_URING
+            "  -u, --uring           read the input asynchronously with io_uring instead of memory-mapping it\n"
+#endif
+            ,
+            name);
+}
+
+// Returns whether bands is a comma separated list of at most SDFT_MAX_BAND_EDGES non-negative integers.
+static int valid_band_edges(const char *bands)
+{
+    size_t n_edges = 0;
+    const char *c = bands;
+    while (1) {
+        if (*c < '0' || *c > '9') {
+            return 0;
+        }
+        char *end;
+        errno = 0;
+        strtoul(c, &end, 10);
+        if (errno == ERANGE || ++n_edges > SDFT_MAX_BAND_EDGES) {
+            return 0;
+        }
+        if (*end == '\0') {
+            return 1;
+        }
+        if (*end != ',') {
+            return 0;
+        }
+        c = end + 1;
+    }
+}
+
+static int parse_options(int argc, char **argv, struct options *o)
+{
+    static const struct option long_options[] = {
+            {"format",      required_argument, 0, 'f'},
+            {"channels",    required_argument, 0, 'c'},
+            {"channel",     required_argument, 0, 'C'},
+            {"window-size", required_argument, 0, 'n'},
+            {"precision",   required_argument, 0, 'p'},
+            {"traits",      required_argument, 0, 't'},
+            {"hop",         required_argument, 0, 'H'},
+            {"combined",    no_argument,       0, 's'},
+            {"output",      required_argument, 0, 'o'},
+            {"bands",       required_argument, 0, 'b'},
+            {"binary",      no_argument,       0, 'B'},
+            {"gain",        required_argument, 0, 'g'},
+            {"dc",          required_argument, 0, 'd'},
+            {"uring",       no_argument,       0, 'u'},
+            {0, 0, 0, 0}
+    };
+
+    memset(o, 0, sizeof(*o));
+    o->format = -1;
+    o->n_channels = 1;
+    o->window_size = 1024;
+    o->precision = SDFT_DOUBLE;
+    o->traits = SDFT_REAL_ONLY;
+    o->output_kind = OUTPUT_POWER;
+    o->gain = 1;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "f:c:C:n:p:t:H:so:b:Bg:d:u", long_options, 0)) != -1) {
+        switch (c) {
+            case 'f':
+                if (!strcmp(optarg, "wav")) o->format = -2;
+                else if (!strcmp(optarg, "s16")) o->format = SDFT_PCM_S16;
+                else if (!strcmp(optarg, "s32")) o->format = SDFT_PCM_S32;
+                else if (!strcmp(optarg, "f32")) o->format = SDFT_PCM_F32;
+                else if (!strcmp(optarg, "f64")) o->format = SDFT_PCM_F64;
+                else return 0;
+                break;
+            case 'c':
+                o->n_channels = strtoul(optarg, 0, 10);
+                break;
+            case 'C':
+                o->channel = strtoul(optarg, 0, 10);
+                break;
+            case 'n':
+                o->window_size = strtoul(optarg, 0, 10);
+                break;
+            case 'p':
+                if (!strcmp(optarg, "single")) o->precision = SDFT_SINGLE;
+                else if (!strcmp(optarg, "double")) o->precision = SDFT_DOUBLE;
+                else if (!strcmp(optarg, "long")) o->precision = SDFT_LONG_DOUBLE;
+                else return 0;
+                break;
+            case 't':
+                if (!strcmp(optarg, "real")) o->traits = SDFT_REAL_ONLY;
+                else if (!strcmp(optarg, "mixed")) o->traits = SDFT_REAL_AND_IMAG;
+                else return 0;
+                break;
+            case 'H':
+                o->hop_size = strtoul(optarg, 0, 10);
+                break;
+            case 's':
+                o->combined = 1;
+                break;
+            case 'o':
+                if (!strcmp(optarg, "spectrum")) o->output_kind = OUTPUT_SPECTRUM;
+                else if (!strcmp(optarg, "power")) o->output_kind = OUTPUT_POWER;
+                else if (!strcmp(optarg, "bands")) o->output_kind = OUTPUT_BANDS;
+                else return 0;
+                break;
+            case 'b':
+                if (!valid_band_edges(optarg)) {
+                    return 0;
+                }
+                o->bands = optarg;
+                o->output_kind = OUTPUT_BANDS;
+                break;
+            case 'B':
+                o->binary = 1;
+                break;
+            case 'g':
+                o->gain = strtod(optarg, 0);
+                break;
+            case 'd':
+                o->dc_pole = strtod(optarg, 0);
+                break;
+#ifdef SDFT_HAVE_URING
+            case 'u':
+                o->uring = 1;
+                break;
+#endif
+            default:
+                return 0;
+        }
+    }
+
+    if (optind >= argc || argc - optind > 2 || (o->output_kind == OUTPUT_BANDS && !o->bands)) {
+        return 0;
+    }
+    o->input = argv[optind];
+    o->output = optind + 1 < argc ? argv[optind + 1] : 0;
+    if (o->hop_size == 0) {
+        o->hop_size = o->window_size;
+    }
+    if (o->format == -1) {
+        size_t length = strlen(o->input);
+        o->format = length >= 4 && !strcmp(o->input + length - 4, ".wav") ? -2 : SDFT_PCM_S16;
+    }
+
+    return 1;
+}
+
+//
+// Input
+//
+
+static uint32_t read_u32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static uint16_t read_u16(const unsigned char *p)
+{
+    return (uint16_t) (p[0] | (p[1] << 8));
+}
+
+// Locates the sample data in a RIFF/WAVE file and determines its format.
+static const char *parse_wav(struct input *in, const unsigned char *data, size_t size)
+{
+    if (size < 12 || memcmp(data, "RIFF", 4) || memcmp(data + 8, "WAVE", 4)) {
+        return "not a RIFF/WAVE file";
+    }
+
+    int have_format = 0;
+    size_t offset = 12;
+    while (offset + 8 <= size) {
+        const unsigned char *chunk = data + offset;
+        size_t chunk_size = read_u32(chunk + 4);
+        if (!memcmp(chunk, "fmt ", 4) && chunk_size >= 16 && offset + 8 + chunk_size <= size) {
+            unsigned tag = read_u16(chunk + 8);
+            unsigned bits = read_u16(chunk + 22);
+            in->n_channels = read_u16(chunk + 10);
+            if (tag == 0xFFFE && chunk_size >= 26) {
+                // WAVE_FORMAT_EXTENSIBLE, the sub format starts with the format tag
+                tag = read_u16(chunk + 32);
+            }
+            if (tag == 1 && bits == 16) in->format = SDFT_PCM_S16;
+            else if (tag == 1 && bits == 32) in->format = SDFT_PCM_S32;
+            else if (tag == 3 && bits == 32) in->format = SDFT_PCM_F32;
+            else if (tag == 3 && bits == 64) in->format = SDFT_PCM_F64;
+            else return "unsupported WAV sample format (supported: 16/32 bit integer, 32/64 bit float)";
+            have_format = 1;
+        } else if (!memcmp(chunk, "data", 4)) {
+            if (!have_format) {
+                return "WAV data chunk before fmt chunk";
+            }
+            in->frames = chunk + 8;
+            // the size of a streamed file may not have been patched in
+            size_t available = size - offset - 8;
+            size_t data_size = chunk_size < available ? chunk_size : available;
+            size_t frame_size = in->n_channels * (in->format == SDFT_PCM_S16 ? 2 : in->format == SDFT_PCM_F64 ? 8 : 4);
+            in->n_frames = frame_size ? data_size / frame_size : 0;
+            return 0;
+        }
+        offset += 8 + chunk_size + (chunk_size & 1);
+    }
+
+    return "WAV file without data chunk";
+}
+
+static const char *open_input(struct input *in, const struct options *o)
+{
+    int fd = open(o->input, O_RDONLY);
+    if (fd < 0) {
+        return strerror(errno);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        return strerror(errno);
+    }
+
+    in->mapping_size = (size_t) st.st_size;
+    in->mapping = in->mapping_size ? mmap(0, in->mapping_size, PROT_READ, MAP_PRIVATE, fd, 0) : 0;
+    close(fd);
+    if (in->mapping == MAP_FAILED) {
+        return strerror(errno);
+    }
+    if (in->mapping) {
+        posix_madvise(in->mapping, in->mapping_size, POSIX_MADV_SEQUENTIAL);
+    }
+
+    if (o->format == -2) {
+        return parse_wav(in, in->mapping, in->mapping_size);
+    }
+
+    in->format = (enum sdft_SampleFormat) o->format;
+    in->n_channels = o->n_channels;
+    in->frames = in->mapping;
+    size_t frame_size = in->n_channels * (in->format == SDFT_PCM_S16 ? 2 : in->format == SDFT_PCM_F64 ? 8 : 4);
+    in->n_frames = frame_size ? in->mapping_size / frame_size : 0;
+    return 0;
+}
+
+#ifdef SDFT_HAVE_URING
+
+// Streams the frames through the pipeline with the reads running ahead asynchronously. The mapping of the input is
+// only used to locate the frames, which are read into the registered buffers and processed from there.
+static const char *process_with_uring(struct sdft_Pipeline *pipeline, const struct input *in,
+        const struct options *o, size_t frame_size)
+{
+    int fd = open(o->input, O_RDONLY);
+    if (fd < 0) {
+        return strerror(errno);
+    }
+
+    struct uring_source source;
+    const char *error = uring_source_open(&source, fd, (uint64_t) (in->frames - (const unsigned char *) in->mapping),
+            (uint64_t) in->n_frames * frame_size, BLOCK_FRAMES * frame_size, URING_BLOCKS);
+    close(fd);
+    while (!error) {
+        const unsigned char *data;
+        size_t size;
+        error = uring_source_next(&source, &data, &size);
+        if (error || size == 0) {
+            break;
+        }
+        if (sdft_pipeline_process(pipeline, data, size / frame_size) != SDFT_NO_ERROR) {
+            error = "processing failed";
+        }
+    }
+    uring_source_close(&source);
+
+    return error;
+}
+
+#endif
+
+//
+// Output
+//
+
+static size_t size_of_float(enum sdft_FloatPrecision precision)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            return sizeof(float);
+        case SDFT_DOUBLE:
+            return sizeof(double);
+        default:
+            return sizeof(long double);
+    }
+}
+
+static long double float_at(const void *data, size_t i, enum sdft_FloatPrecision precision)
+{
+    switch (precision) {
+        case SDFT_SINGLE:
+            return ((const float *) data)[i];
+        case SDFT_DOUBLE:
+            return ((const double *) data)[i];
+        default:
+            return ((const long double *) data)[i];
+    }
+}
+
+static void write_output(void *user_data, const void *data, size_t n_elements, unsigned long long n_samples)
+{
+    struct writer *w = user_data;
+
+    if (w->binary) {
+        fwrite(&n_samples, sizeof(n_samples), 1, w->file);
+        fwrite(data, w->complex ? 2 * size_of_float(w->precision) : sizeof(double), n_elements, w->file);
+        return;
+    }
+
+    fprintf(w->file, "%llu", n_samples);
+    for (size_t i = 0; i < n_elements; ++i) {
+        if (w->complex) {
+            fprintf(w->file, ",%.9Lg,%.9Lg", float_at(data, 2 * i, w->precision),
+                    float_at(data, 2 * i + 1, w->precision));
+        } else {
+            fprintf(w->file, ",%.9g", ((const double *) data)[i]);
+        }
+    }
+    fputc('\n', w->file);
+}
+
+//
+// Main
+//
+
+// Appends formatted text to the string of length *length in buffer, returns 0 if it does not fit.
+static int append(char *buffer, size_t size, size_t *length, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(buffer + *length, size - *length, format, args);
+    va_end(args);
+    if (n < 0 || (size_t) n >= size - *length) {
+        buffer[*length] = '\0';
+        return 0;
+    }
+
+    *length += (size_t) n;
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    struct options o;
+    if (!parse_options(argc, argv, &o)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct input in;
+    memset(&in, 0, sizeof(in));
+    const char *error = open_input(&in, &o);
+    if (error) {
+        fprintf(stderr, "%s: %s\n", o.input, error);
+        return 1;
+    }
+    if (o.channel >= in.n_channels) {
+        fprintf(stderr, "%s: channel %zu out of range, the input has %zu channels\n", o.input, o.channel,
+                in.n_channels);
+        return 1;
+    }
+
+    // the pipeline, with room for the longest numbers and the most band edges the parser accepts
+    char config[256 + SDFT_MAX_BAND_EDGES * 24];
+    size_t length = 0;
+    int fits = 1;
+    if (o.gain != 1) {
+        fits = fits && append(config, sizeof(config), &length, "gain %.17g | ", o.gain);
+    }
+    if (o.dc_pole != 0) {
+        fits = fits && append(config, sizeof(config), &length, "dc %.17g | ", o.dc_pole);
+    }
+    fits = fits && append(config, sizeof(config), &length, "sdft %zu | ", o.hop_size);
+    if (o.output_kind == OUTPUT_POWER) {
+        fits = fits && append(config, sizeof(config), &length, "power | ");
+    } else if (o.output_kind == OUTPUT_BANDS) {
+        fits = fits && append(config, sizeof(config), &length, "bands");
+        for (const char *c = o.bands; fits && *c; ) {
+            char *end;
+            unsigned long edge = strtoul(c, &end, 10);
+            fits = append(config, sizeof(config), &length, " %lu", edge);
+            c = *end == ',' ? end + 1 : end;
+        }
+        fits = fits && append(config, sizeof(config), &length, " | ");
+    }
+    fits = fits && append(config, sizeof(config), &length, "sink 0");
+
+    struct sdft_Stage stages[8];
+    size_t n_stages;
+    if (!fits) {
+        fprintf(stderr, "invalid pipeline: too many band edges\n");
+        return 2;
+    }
+    if (sdft_parse_pipeline(config, stages, 8, &n_stages) != SDFT_NO_ERROR) {
+        fprintf(stderr, "invalid pipeline: %s\n", config);
+        return 2;
+    }
+
+    // the state(s), with all buffers starting out zero'ed
+    size_t n_states = o.combined ? 2 : 1;
+    size_t complex_size = 2 * size_of_float(o.precision);
+    void *windows = calloc(n_states * o.window_size, complex_size);
+    void *spectra = calloc(n_states * o.window_size, complex_size);
+    void *phase_offsets = calloc(n_states * o.window_size, complex_size);
+    struct sdft_State *states[3];
+    for (size_t i = 0; i < 3; ++i) {
+        states[i] = malloc(sdft_size_of_state());
+    }
+    if (!windows || !spectra || !phase_offsets || !states[0] || !states[1] || !states[2]) {
+        fprintf(stderr, "could not allocate the sdft: %s\n", strerror(ENOMEM));
+        return 1;
+    }
+    for (size_t i = 0; i < n_states; ++i) {
+        enum sdft_Error err = sdft_init_from_buffers(states[i], o.precision,
+                (char *) windows + i * o.window_size * complex_size,
+                (char *) spectra + i * o.window_size * complex_size,
+                (char *) phase_offsets + i * o.window_size * complex_size, o.window_size, o.traits);
+        if (err != SDFT_NO_ERROR) {
+            fprintf(stderr, "could not initialize the sdft (error %d)\n", err);
+            return 2;
+        }
+    }
+    struct sdft_State *state = states[0];
+    if (o.combined) {
+        enum sdft_Error err = sdft_init_combine(states[2], states[0], states[1]);
+        if (err != SDFT_NO_ERROR) {
+            fprintf(stderr, "could not initialize the sdft (error %d)\n", err);
+            return 2;
+        }
+        state = states[2];
+    }
+
+    FILE *file = o.output ? fopen(o.output, o.binary ? "wb" : "w") : stdout;
+    if (!file) {
+        fprintf(stderr, "%s: %s\n", o.output, strerror(errno));
+        return 1;
+    }
+    struct writer w = {file, o.binary, o.output_kind == OUTPUT_SPECTRUM, o.precision};
+    sdft_Sink sinks[1] = {&write_output};
+    void *sink_data[1] = {&w};
+
+    struct sdft_Pipeline *pipeline = malloc(sdft_size_of_pipeline());
+    void *buffer = malloc(sdft_pipeline_buffer_size(state, stages, n_stages) + 1);
+    if (!pipeline || !buffer) {
+        fprintf(stderr, "could not allocate the pipeline: %s\n", strerror(ENOMEM));
+        return 1;
+    }
+    enum sdft_Error err = sdft_init_pipeline(pipeline, state, in.format, in.n_channels, o.channel, stages, n_stages,
+            sinks, sink_data, 1, buffer);
+    if (err != SDFT_NO_ERROR) {
+        fprintf(stderr, "invalid pipeline: %s (error %d)\n", config, err);
+        return 2;
+    }
+
+    // the actual work
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    size_t frame_size = in.n_channels * (in.format == SDFT_PCM_S16 ? 2 : in.format == SDFT_PCM_F64 ? 8 : 4);
+#ifdef SDFT_HAVE_URING
+    if (o.uring) {
+        error = process_with_uring(pipeline, &in, &o, frame_size);
+        if (error) {
+            fprintf(stderr, "%s: %s\n", o.input, error);
+            return 1;
+        }
+    }
+#endif
+    for (size_t f = 0; f < in.n_frames && !o.uring; f += BLOCK_FRAMES) {
+        size_t n = in.n_frames - f < BLOCK_FRAMES ? in.n_frames - f : BLOCK_FRAMES;
+        err = sdft_pipeline_process(pipeline, in.frames + f * frame_size, n);
+        if (err != SDFT_NO_ERROR) {
+            fprintf(stderr, "processing failed at frame %zu (error %d)\n", f, err);
+            return 1;
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    fprintf(stderr, "%zu samples in %.3f s: %.0f samples/s\n", in.n_frames, seconds,
+            seconds > 0 ? in.n_frames / seconds : 0);
+
+    if (file != stdout) {
+        fclose(file);
+    }
+    free(buffer);
+    free(pipeline);
+    for (size_t i = 0; i < 3; ++i) {
+        free(states[i]);
+    }
+    free(windows);
+    free(spectra);
+    free(phase_offsets);
+    if (in.mapping) {
+        munmap(in.mapping, in.mapping_size);
+    }
+
+    return 0;
+}
@@ -0,0 +1,453 @@
+// sdftd: a daemon which hosts sdft states for other processes on the same machine.
+//
+// Producers connect to a Unix socket, create sessions of states and write their samples into a shared memory ring per
+// session. The daemon drains the rings into the states, which live in a sdft_Pool that the producer (or anyone it
+// passes the descriptor to) maps read-only to read the spectra. See sdftd_protocol.h for the protocol. Run without
+// arguments for usage information.
+//
+// The daemon serves all sessions from a single thread and publishes spectra only. It does not (yet) share twiddle
+// tables between sessions, spread the sessions over worker threads or NUMA nodes, or publish band outputs.
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <getopt.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "sdft/sdft.h"
+#include "sdft/sdft_pool.h"
+#include "sdftd_protocol.h"
+
+#define MAX_CLIENTS 256
+
+#ifndef F_SEAL_FUTURE_WRITE
+#define F_SEAL_FUTURE_WRITE 0x0010
+#endif
+
+struct options {
+    const char *socket_path;
+    // the maximum number of frames drained from one ring before moving on to the next
+    size_t budget;
+};
+
+struct session {
+    unsigned long id;
+    int client;
+    size_t n_states;
+    size_t complex_size;
+    // the layout of the ring, kept here as the producer can overwrite the copy in the ring
+    size_t frame_size;
+    uint64_t capacity;
+    struct sdft_Pool *pool;
+    struct sdft_State **states;
+    struct sdftd_Ring *ring;
+    size_t ring_size;
+    int ring_fd;
+};
+
+struct daemon {
+    int listener;
+    int clients[MAX_CLIENTS];
+    size_t n_clients;
+    struct session **sessions;
+    size_t n_sessions;
+    unsigned long next_id;
+};
+
+static volatile sig_atomic_t stop;
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] -s socket\n"
+            "\n"
+            "Hosts sdft states for producer processes which connect to the Unix socket, see sdftd_protocol.h.\n"
+            "\n"
+            "  -s, --socket PATH     the path of the control socket, which must not exist yet\n"
+            "  -b, --budget N        frames drained from a ring before serving the next one (default: 4096)\n"
+            "  -h, --help            show this help\n",
+            name);
+}
+
+static int parse_options(int argc, char **argv, struct options *o)
+{
+    static const struct option long_options[] = {
+            {"socket", required_argument, 0, 's'},
+            {"budget", required_argument, 0, 'b'},
+            {"help",   no_argument,       0, 'h'},
+            {0, 0,                        0, 0}
+    };
+
+    o->socket_path = 0;
+    o->budget = 4096;
+
+    int c;
+    while ((c = getopt_long(argc, argv, "s:b:h", long_options, 0)) != -1) {
+        switch (c) {
+            case 's':
+                o->socket_path = optarg;
+                break;
+            case 'b':
+                o->budget = strtoul(optarg, 0, 10);
+                break;
+            default:
+                return 0;
+        }
+    }
+
+    return o->socket_path != 0 && o->budget > 0 && optind == argc;
+}
+
+static void handle_signal(int signal)
+{
+    (void) signal;
+    stop = 1;
+}
+
+static size_t size_of_float(enum sdft_FloatPrecision precision)
+{
+    return precision == SDFT_SINGLE ? sizeof(float) : precision == SDFT_DOUBLE ? sizeof(double) : sizeof(long double);
+}
+
+//
+// Sessions
+//
+
+static void destroy_session(struct session *s)
+{
+    if (s->ring) {
+        munmap(s->ring, s->ring_size);
+    }
+    if (s->ring_fd >= 0) {
+        close(s->ring_fd);
+    }
+    if (s->states) {
+        for (size_t i = 0; i < s->n_states; ++i) {
+            free(s->states[i]);
+        }
+        free(s->states);
+    }
+    if (s->pool) {
+        sdft_pool_close(s->pool);
+        free(s->pool);
+    }
+    free(s);
+}
+
+// Returns an error message or NULL.
+static const char *create_session(struct session *s, const char *command)
+{
+    char precision_name[16], traits_name[16], kind_name[16];
+    size_t n_states, window_size, capacity;
+    if (sscanf(command, "create %zu %15s %zu %15s %15s %zu", &n_states, precision_name, &window_size, traits_name,
+            kind_name, &capacity) != 6) {
+        return "usage: create N_STATES PRECISION WINDOW_SIZE TRAITS KIND CAPACITY";
+    }
+
+    enum sdft_FloatPrecision precision;
+    if (strcmp(precision_name, "single") == 0) {
+        precision = SDFT_SINGLE;
+    } else if (strcmp(precision_name, "double") == 0) {
+        precision = SDFT_DOUBLE;
+    } else if (strcmp(precision_name, "long") == 0) {
+        precision = SDFT_LONG_DOUBLE;
+    } else {
+        return "precision has to be single, double or long";
+    }
+    if (strcmp(traits_name, "real") != 0 && strcmp(traits_name, "complex") != 0) {
+        return "traits have to be real or complex";
+    }
+    enum sdft_SignalTraits traits = traits_name[0] == 'r' ? SDFT_REAL_ONLY : SDFT_REAL_AND_IMAG;
+    if (strcmp(kind_name, "plain") != 0 && strcmp(kind_name, "combined") != 0) {
+        return "kind has to be plain or combined";
+    }
+    enum sdft_FlatKind kind = kind_name[0] == 'p' ? SDFT_FLAT_PLAIN : SDFT_FLAT_COMBINED;
+    if (n_states < 1 || capacity < 1 || (capacity & (capacity - 1)) != 0) {
+        return "the number of states has to be positive and the capacity a power of two";
+    }
+
+    s->complex_size = 2 * size_of_float(precision);
+    if (n_states > UINT32_MAX / s->complex_size
+            || capacity > (SIZE_MAX - sizeof(struct sdftd_Ring)) / (n_states * s->complex_size)) {
+        return "the ring would be too large";
+    }
+
+    // the states
+    s->pool = malloc(sdft_size_of_pool());
+    if (!s->pool) {
+        return strerror(ENOMEM);
+    }
+    if (sdft_pool_create(s->pool, 0, n_states, precision, window_size, traits, kind) != SDFT_NO_ERROR) {
+        free(s->pool);
+        s->pool = 0;
+        return "could not create the pool";
+    }
+    // the descriptor goes to the producer, which must not be able to write the states the daemon pushes into
+    int seals = fcntl(sdft_pool_get_fd(s->pool), F_GET_SEALS);
+    if (seals < 0 || !(seals & F_SEAL_FUTURE_WRITE)) {
+        return "the kernel cannot seal the pool read-only";
+    }
+    s->states = calloc(n_states, sizeof(struct sdft_State *));
+    if (!s->states) {
+        return strerror(ENOMEM);
+    }
+    s->n_states = n_states;
+    for (size_t i = 0; i < n_states; ++i) {
+        s->states[i] = malloc(sdft_size_of_state());
+        if (!s->states[i]) {
+            return strerror(ENOMEM);
+        }
+        if (sdft_init_from_flat(s->states[i], sdft_pool_get_state(s->pool, i)) != SDFT_NO_ERROR) {
+            return "could not attach to the pool";
+        }
+    }
+
+    // the ring
+    s->frame_size = n_states * s->complex_size;
+    s->capacity = capacity;
+    s->ring_size = sdftd_ring_size(s->frame_size, capacity);
+    s->ring_fd = memfd_create("sdftd_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    // the producer may write the ring, but resizing it would make the daemon fault on its mapping
+    if (s->ring_fd < 0 || ftruncate(s->ring_fd, (off_t) s->ring_size) != 0
+            || fcntl(s->ring_fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) != 0) {
+        return strerror(errno);
+    }
+    void *ring = mmap(0, s->ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, s->ring_fd, 0);
+    if (ring == MAP_FAILED) {
+        return strerror(errno);
+    }
+    s->ring = ring;
+    s->ring->magic = SDFTD_RING_MAGIC;
+    s->ring->frame_size = (uint32_t) s->frame_size;
+    s->ring->capacity = capacity;
+    atomic_init(&s->ring->head, 0);
+    atomic_init(&s->ring->tail, 0);
+
+    return 0;
+}
+
+// Pushes up to budget frames of the ring of s into its states and returns the number of frames.
+static size_t drain_session(struct session *s, size_t budget)
+{
+    struct sdftd_Ring *ring = s->ring;
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    // the ring is writable by the producer, so never trust it to hold more than capacity frames, and only use the
+    // layout of the session to address frames
+    uint64_t available = head - tail < s->capacity ? head - tail : s->capacity;
+    size_t n = available < budget ? (size_t) available : budget;
+    if (n == 0) {
+        return 0;
+    }
+
+    // state by state, so each state stays in the cache for the whole batch, and readers see each state once per batch
+    for (size_t i = 0; i < s->n_states; ++i) {
+        sdft_pool_begin_write(s->pool, i);
+        for (uint64_t f = tail; f < tail + n; ++f) {
+            unsigned char *frame = ring->frames + (f & (s->capacity - 1)) * s->frame_size;
+            sdft_push_next_sample(s->states[i], frame + i * s->complex_size);
+        }
+        sdft_pool_end_write(s->pool, i);
+    }
+
+    atomic_store_explicit(&ring->tail, tail + n, memory_order_release);
+    return n;
+}
+
+//
+// Control channel
+//
+
+static void reply(int client, const char *message, const int *fds, size_t n_fds)
+{
+    struct iovec iov = {(void *) message, strlen(message)};
+    union {
+        char buffer[CMSG_SPACE(2 * sizeof(int))];
+        struct cmsghdr align;
+    } control;
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (n_fds > 0) {
+        msg.msg_control = control.buffer;
+        msg.msg_controllen = CMSG_SPACE(n_fds * sizeof(int));
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(n_fds * sizeof(int));
+        memcpy(CMSG_DATA(cmsg), fds, n_fds * sizeof(int));
+    }
+    if (sendmsg(client, &msg, MSG_NOSIGNAL) < 0) {
+        fprintf(stderr, "sdftd: reply failed: %s\n", strerror(errno));
+    }
+}
+
+static void remove_session(struct daemon *d, size_t index)
+{
+    destroy_session(d->sessions[index]);
+    d->sessions[index] = d->sessions[--d->n_sessions];
+}
+
+static void handle_command(struct daemon *d, int client, const char *command)
+{
+    char message[SDFTD_MAX_COMMAND];
+    if (strncmp(command, "create ", 7) == 0) {
+        struct session *s = calloc(1, sizeof(struct session));
+        struct session **sessions = realloc(d->sessions, (d->n_sessions + 1) * sizeof(struct session *));
+        if (!s || !sessions) {
+            free(s);
+            if (sessions) {
+                d->sessions = sessions;
+            }
+            reply(client, "error out of memory", 0, 0);
+            return;
+        }
+        d->sessions = sessions;
+        s->client = client;
+        s->ring_fd = -1;
+        const char *error = create_session(s, command);
+        if (error) {
+            snprintf(message, sizeof(message), "error %s", error);
+            destroy_session(s);
+            reply(client, message, 0, 0);
+            return;
+        }
+
+        s->id = d->next_id++;
+        d->sessions[d->n_sessions++] = s;
+        snprintf(message, sizeof(message), "ok %lu %zu", s->id, sdft_get_number_of_bins(s->states[0]));
+        int fds[2] = {s->ring_fd, sdft_pool_get_fd(s->pool)};
+        reply(client, message, fds, 2);
+    } else if (strncmp(command, "destroy ", 8) == 0) {
+        unsigned long id = strtoul(command + 8, 0, 10);
+        for (size_t i = 0; i < d->n_sessions; ++i) {
+            // producers may only destroy their own sessions
+            if (d->sessions[i]->id == id && d->sessions[i]->client == client) {
+                remove_session(d, i);
+                reply(client, "ok", 0, 0);
+                return;
+            }
+        }
+        reply(client, "error no such session", 0, 0);
+    } else {
+        reply(client, "error unknown command", 0, 0);
+    }
+}
+
+static void disconnect(struct daemon *d, size_t index)
+{
+    int client = d->clients[index];
+    for (size_t i = d->n_sessions; i-- > 0;) {
+        if (d->sessions[i]->client == client) {
+            remove_session(d, i);
+        }
+    }
+    close(client);
+    d->clients[index] = d->clients[--d->n_clients];
+}
+
+// Serves the control channel, waiting at most timeout milliseconds for commands.
+static void serve(struct daemon *d, int timeout)
+{
+    struct pollfd fds[MAX_CLIENTS + 1];
+    fds[0].fd = d->listener;
+    fds[0].events = POLLIN;
+    for (size_t i = 0; i < d->n_clients; ++i) {
+        fds[i + 1].fd = d->clients[i];
+        fds[i + 1].events = POLLIN;
+    }
+    if (poll(fds, d->n_clients + 1, timeout) <= 0) {
+        return;
+    }
+
+    // backwards, as disconnecting moves the last client into the freed slot
+    for (size_t i = d->n_clients; i-- > 0;) {
+        if (!fds[i + 1].revents) {
+            continue;
+        }
+        char command[SDFTD_MAX_COMMAND];
+        ssize_t length = recv(d->clients[i], command, sizeof(command) - 1, 0);
+        if (length <= 0) {
+            disconnect(d, i);
+            continue;
+        }
+        command[length] = 0;
+        handle_command(d, d->clients[i], command);
+    }
+
+    if (fds[0].revents & POLLIN) {
+        int client = accept4(d->listener, 0, 0, SOCK_CLOEXEC);
+        if (client >= 0 && d->n_clients == MAX_CLIENTS) {
+            close(client);
+        } else if (client >= 0) {
+            d->clients[d->n_clients++] = client;
+        }
+    }
+}
+
+//
+// Main
+//
+
+int main(int argc, char **argv)
+{
+    struct options o;
+    if (!parse_options(argc, argv, &o)) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (strlen(o.socket_path) >= sizeof(address.sun_path)) {
+        fprintf(stderr, "%s: path too long\n", o.socket_path);
+        return 2;
+    }
+    strcpy(address.sun_path, o.socket_path);
+
+    struct daemon d;
+    memset(&d, 0, sizeof(d));
+    d.listener = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0);
+    if (d.listener < 0 || bind(d.listener, (struct sockaddr *) &address, sizeof(address)) != 0
+            || listen(d.listener, 16) != 0) {
+        fprintf(stderr, "%s: %s\n", o.socket_path, strerror(errno));
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = &handle_signal;
+    sigaction(SIGINT, &action, 0);
+    sigaction(SIGTERM, &action, 0);
+
+    // drain the rings as long as there are samples, and only sleep in poll when all of them are empty
+    int timeout = -1;
+    while (!stop) {
+        serve(&d, timeout);
+        size_t n_frames = 0;
+        for (size_t i = 0; i < d.n_sessions; ++i) {
+            n_frames += drain_session(d.sessions[i], o.budget);
+        }
+        timeout = d.n_sessions == 0 ? -1 : n_frames > 0 ? 0 : 1;
+    }
+
+    while (d.n_clients > 0) {
+        disconnect(&d, d.n_clients - 1);
+    }
+    free(d.sessions);
+    close(d.listener);
+    unlink(o.socket_path);
+
+    return 0;
+}
@@ -0,0 +1,73 @@
+// The protocol between sdftd and its producers.
+//
+// Control channel: a SOCK_SEQPACKET Unix socket, one text command per message, one reply per command.
+//
+//     create N_STATES PRECISION WINDOW_SIZE TRAITS KIND CAPACITY
+//         PRECISION: single, double or long; TRAITS: real or complex; KIND: plain or combined; CAPACITY: the number
+//         of frames of the ring, a power of two.
+//         reply: "ok ID N_BINS" with two file descriptors attached (SCM_RIGHTS): the ring to map read-write and
+//         the sdft_Pool holding the states, to open with sdft_pool_open_fd. Both are sealed against resizing, the
+//         pool also against writable mappings.
+//     destroy ID
+//         reply: "ok"
+//
+// Failed commands are answered with "error MESSAGE". The sessions of a producer are destroyed when it closes the
+// connection.
+//
+// Sample ring: a single-producer single-consumer ring of frames in shared memory. A frame holds one complex sample
+// (of the precision of the session) for each state, state 0 first. The producer only writes head, the daemon only
+// writes tail, so neither side ever blocks the other.
+
+#pragma once
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#define SDFTD_RING_MAGIC 0x474E4952u // "RING"
+
+#define SDFTD_MAX_COMMAND 256
+
+struct sdftd_Ring {
+    uint32_t magic;
+    uint32_t frame_size;
+    uint64_t capacity;
+    // the number of frames written so far, on its own cache line
+    _Alignas(64) _Atomic uint64_t head;
+    // the number of frames consumed so far
+    _Alignas(64) _Atomic uint64_t tail;
+    _Alignas(64) unsigned char frames[];
+};
+
+static inline size_t sdftd_ring_size(size_t frame_size, size_t capacity)
+{
+    return sizeof(struct sdftd_Ring) + frame_size * capacity;
+}
+
+static inline unsigned char *sdftd_ring_frame(struct sdftd_Ring *ring, uint64_t index)
+{
+    return ring->frames + (index & (ring->capacity - 1)) * ring->frame_size;
+}
+
+// Copies up to n_frames frames into the ring and returns how many fit. Producer side only.
+static inline size_t sdftd_ring_write(struct sdftd_Ring *ring, const void *frames, size_t n_frames)
+{
+    uint64_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    uint64_t tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    size_t n = (size_t) (ring->capacity - (head - tail));
+    if (n > n_frames) {
+        n = n_frames;
+    }
+
+    // at most two copies, before and after the wrap-around
+    size_t first = (size_t) (ring->capacity - (head & (ring->capacity - 1)));
+    if (first > n) {
+        first = n;
+    }
+    memcpy(sdftd_ring_frame(ring, head), frames, first * ring->frame_size);
+    memcpy(ring->frames, (const unsigned char *) frames + first * ring->frame_size, (n - first) * ring->frame_size);
+
+    atomic_store_explicit(&ring->head, head + n, memory_order_release);
+    return n;
+}
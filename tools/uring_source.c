@@ -0,0 +1,286 @@
+// An asynchronous file source for sdft-cli based on io_uring, see uring_source.h.
+//
+// liburing is not required, the rings are set up with the raw system calls.
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <linux/io_uring.h>
+
+#include "uring_source.h"
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *params)
+{
+    return (int) syscall(__NR_io_uring_setup, entries, params);
+}
+
+static int io_uring_enter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return (int) syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, 0, 0);
+}
+
+static int io_uring_register(int ring_fd, unsigned opcode, const void *arg, unsigned n_args)
+{
+    return (int) syscall(__NR_io_uring_register, ring_fd, opcode, arg, n_args);
+}
+
+// Queues a read of the rest of buffer i, which is submitted with the next io_uring_enter.
+static void queue_read(struct uring_source *s, unsigned i)
+{
+    unsigned tail = *s->sq_tail;
+    unsigned index = tail & *s->sq_mask;
+    struct io_uring_sqe *sqe = (struct io_uring_sqe *) s->sqes + index;
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = s->fixed ? IORING_OP_READ_FIXED : IORING_OP_READ;
+    sqe->fd = s->file_fd;
+    sqe->addr = (uint64_t) (uintptr_t) (s->buffers + i * s->block_size + s->filled[i]);
+    sqe->len = (uint32_t) (s->requested[i] - s->filled[i]);
+    sqe->off = s->offsets[i] + s->filled[i];
+    sqe->buf_index = (uint16_t) i;
+    sqe->user_data = i;
+    s->sq_array[index] = index;
+    // the kernel must see the entry before the new tail
+    __atomic_store_n(s->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    ++s->n_unsubmitted;
+    ++s->n_in_flight;
+}
+
+// Assigns the next block of the range to buffer i and queues its read, if any is left.
+static void start_block(struct uring_source *s, unsigned i)
+{
+    if (s->next_offset >= s->end_offset) {
+        s->requested[i] = 0;
+        return;
+    }
+
+    s->offsets[i] = s->next_offset;
+    s->requested[i] = s->end_offset - s->next_offset < s->block_size ? s->end_offset - s->next_offset : s->block_size;
+    s->filled[i] = 0;
+    s->next_offset += s->requested[i];
+    queue_read(s, i);
+}
+
+// Processes all completions, queueing the rest of short reads. Returns an error message or NULL.
+static const char *reap(struct uring_source *s)
+{
+    unsigned head = *s->cq_head;
+    unsigned tail = __atomic_load_n(s->cq_tail, __ATOMIC_ACQUIRE);
+    const char *error = 0;
+    for (; head != tail; ++head) {
+        const struct io_uring_cqe *cqe = (const struct io_uring_cqe *) s->cqes + (head & *s->cq_mask);
+        unsigned i = (unsigned) cqe->user_data;
+        --s->n_in_flight;
+        if (cqe->res < 0) {
+            error = strerror(-cqe->res);
+        } else if (cqe->res == 0) {
+            error = "unexpected end of file";
+        } else {
+            s->filled[i] += (size_t) cqe->res;
+            if (s->filled[i] < s->requested[i]) {
+                queue_read(s, i);
+            }
+        }
+    }
+    __atomic_store_n(s->cq_head, head, __ATOMIC_RELEASE);
+
+    return error;
+}
+
+// Waits until no read writes into the buffers anymore. Returns 0 if that could not be ensured.
+static int drain(struct uring_source *s)
+{
+    while (s->n_in_flight > 0) {
+        // queued reads are submitted as well, as they cannot be taken back from the submission queue
+        int submitted = io_uring_enter(s->ring_fd, s->n_unsubmitted, 1, IORING_ENTER_GETEVENTS);
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 0;
+        }
+        s->n_unsubmitted -= (unsigned) submitted;
+
+        // completions are only counted, short reads are not continued
+        unsigned head = *s->cq_head;
+        unsigned tail = __atomic_load_n(s->cq_tail, __ATOMIC_ACQUIRE);
+        s->n_in_flight -= tail - head;
+        __atomic_store_n(s->cq_head, tail, __ATOMIC_RELEASE);
+    }
+    return 1;
+}
+
+//
+// Implementations of exported functions
+//
+
+const char *uring_source_open(struct uring_source *s, int fd, uint64_t offset, uint64_t length, size_t block_size,
+        unsigned n_blocks)
+{
+    memset(s, 0, sizeof(*s));
+    s->ring_fd = -1;
+    s->file_fd = -1;
+    // a read takes at most one block, whose size has to fit the 32 bit length of a submission
+    if (n_blocks == 0 || block_size == 0 || block_size > UINT32_MAX || n_blocks > SIZE_MAX / block_size) {
+        return strerror(EINVAL);
+    }
+    s->file_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (s->file_fd < 0) {
+        return strerror(errno);
+    }
+
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    s->ring_fd = io_uring_setup(2 * n_blocks, &params);
+    if (s->ring_fd < 0) {
+        return strerror(errno);
+    }
+
+    // map the rings, which share one mapping on newer kernels
+    s->sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    s->cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        s->sq_ring_size = s->cq_ring_size = s->sq_ring_size > s->cq_ring_size ? s->sq_ring_size : s->cq_ring_size;
+    }
+    s->sq_ring = mmap(0, s->sq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s->ring_fd,
+            IORING_OFF_SQ_RING);
+    if (s->sq_ring == MAP_FAILED) {
+        s->sq_ring = 0;
+        return strerror(errno);
+    }
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        s->cq_ring = s->sq_ring;
+    } else {
+        s->cq_ring = mmap(0, s->cq_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s->ring_fd,
+                IORING_OFF_CQ_RING);
+        if (s->cq_ring == MAP_FAILED) {
+            s->cq_ring = 0;
+            return strerror(errno);
+        }
+    }
+    s->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    s->sqes = mmap(0, s->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, s->ring_fd, IORING_OFF_SQES);
+    if (s->sqes == MAP_FAILED) {
+        s->sqes = 0;
+        return strerror(errno);
+    }
+    s->sq_tail = (unsigned *) ((char *) s->sq_ring + params.sq_off.tail);
+    s->sq_mask = (unsigned *) ((char *) s->sq_ring + params.sq_off.ring_mask);
+    s->sq_array = (unsigned *) ((char *) s->sq_ring + params.sq_off.array);
+    s->cq_head = (unsigned *) ((char *) s->cq_ring + params.cq_off.head);
+    s->cq_tail = (unsigned *) ((char *) s->cq_ring + params.cq_off.tail);
+    s->cq_mask = (unsigned *) ((char *) s->cq_ring + params.cq_off.ring_mask);
+    s->cqes = (char *) s->cq_ring + params.cq_off.cqes;
+
+    // the buffers, page aligned for the registration
+    s->block_size = block_size;
+    s->n_blocks = n_blocks;
+    void *buffers = mmap(0, block_size * n_blocks, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (buffers == MAP_FAILED) {
+        return strerror(errno);
+    }
+    s->buffers = buffers;
+    s->offsets = calloc(n_blocks, sizeof(uint64_t));
+    s->requested = calloc(n_blocks, sizeof(size_t));
+    s->filled = calloc(n_blocks, sizeof(size_t));
+    if (!s->offsets || !s->requested || !s->filled) {
+        return strerror(ENOMEM);
+    }
+
+    // registered buffers save pinning the pages on every read, but count against RLIMIT_MEMLOCK, so they are optional
+    struct iovec *iovecs = calloc(n_blocks, sizeof(struct iovec));
+    if (!iovecs) {
+        return strerror(ENOMEM);
+    }
+    for (unsigned i = 0; i < n_blocks; ++i) {
+        iovecs[i].iov_base = s->buffers + i * block_size;
+        iovecs[i].iov_len = block_size;
+    }
+    s->fixed = io_uring_register(s->ring_fd, IORING_REGISTER_BUFFERS, iovecs, n_blocks) == 0;
+    free(iovecs);
+
+    s->next_offset = offset;
+    s->end_offset = offset + length;
+    for (unsigned i = 0; i < n_blocks; ++i) {
+        start_block(s, i);
+    }
+
+    return 0;
+}
+
+const char *uring_source_next(struct uring_source *s, const unsigned char **data, size_t *size)
+{
+    unsigned i;
+    if (s->recycle) {
+        // the previous block has been consumed, so its buffer can take the next block to read
+        i = (unsigned) ((s->next_block - 1) % s->n_blocks);
+        start_block(s, i);
+        s->recycle = 0;
+    }
+
+    i = (unsigned) (s->next_block % s->n_blocks);
+    if (s->requested[i] == 0) {
+        *data = 0;
+        *size = 0;
+        return 0;
+    }
+
+    while (s->filled[i] < s->requested[i]) {
+        int submitted = io_uring_enter(s->ring_fd, s->n_unsubmitted, 1, IORING_ENTER_GETEVENTS);
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return strerror(errno);
+        }
+        s->n_unsubmitted -= (unsigned) submitted;
+        const char *error = reap(s);
+        if (error) {
+            return error;
+        }
+    }
+
+    *data = s->buffers + i * s->block_size;
+    *size = s->filled[i];
+    ++s->next_block;
+    s->recycle = 1;
+    return 0;
+}
+
+void uring_source_close(struct uring_source *s)
+{
+    // the buffers may only be unmapped once no read writes into them anymore, so they are rather leaked if the
+    // outstanding reads cannot be waited for
+    int buffers_idle = s->ring_fd < 0 || drain(s);
+    if (s->ring_fd >= 0) {
+        close(s->ring_fd);
+    }
+    if (s->sqes) {
+        munmap(s->sqes, s->sqes_size);
+    }
+    if (s->cq_ring && s->cq_ring != s->sq_ring) {
+        munmap(s->cq_ring, s->cq_ring_size);
+    }
+    if (s->sq_ring) {
+        munmap(s->sq_ring, s->sq_ring_size);
+    }
+    if (s->buffers && buffers_idle) {
+        munmap(s->buffers, s->block_size * s->n_blocks);
+    }
+    if (s->file_fd >= 0) {
+        close(s->file_fd);
+    }
+    free(s->offsets);
+    free(s->requested);
+    free(s->filled);
+    memset(s, 0, sizeof(*s));
+    s->ring_fd = -1;
+    s->file_fd = -1;
+}
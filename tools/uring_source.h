@@ -0,0 +1,68 @@
+// An asynchronous file source for sdft-cli based on io_uring (Linux only).
+//
+// A range of a file is read in blocks into a set of buffers which are registered with the kernel, keeping all of them
+// in flight. The blocks are handed out in file order directly from the buffers, and a buffer is refilled with the next
+// block not yet requested as soon as the following block is requested.
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct uring_source {
+    int ring_fd;
+    int file_fd;
+    // whether the buffers are registered, i.e. reads use IORING_OP_READ_FIXED
+    int fixed;
+
+    // the memory mapped submission and completion queues
+    void *sq_ring;
+    size_t sq_ring_size;
+    void *cq_ring;
+    size_t cq_ring_size;
+    void *sqes;
+    size_t sqes_size;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    void *cqes;
+    unsigned n_unsubmitted;
+    // the number of queued reads whose completion has not been reaped, which still write into the buffers
+    unsigned n_in_flight;
+
+    unsigned char *buffers;
+    size_t block_size;
+    unsigned n_blocks;
+    // per buffer: the file offset, the number of bytes requested and the number of bytes read so far
+    uint64_t *offsets;
+    size_t *requested;
+    size_t *filled;
+
+    uint64_t next_offset;
+    uint64_t end_offset;
+    // the index of the next block to hand out, and whether the previous one still has to be recycled
+    uint64_t next_block;
+    int recycle;
+};
+
+/**
+* Starts reading length bytes at offset from fd in blocks of block_size bytes with n_blocks reads in flight. Returns
+* an error message or NULL. The source uses its own descriptor, so the caller may close fd afterwards.
+*/
+const char *uring_source_open(struct uring_source *source, int fd, uint64_t offset, uint64_t length, size_t block_size,
+        unsigned n_blocks);
+
+/**
+* Waits for the next block in file order and returns an error message or NULL. On success, *data points to *size bytes
+* of data, which stay valid until the next call, and *size is 0 at the end of the range.
+*/
+const char *uring_source_next(struct uring_source *source, const unsigned char **data, size_t *size);
+
+/**
+* Waits for the reads still in flight and releases the source. block_size has to be within [1, UINT32_MAX] and n_blocks
+* at least 1, otherwise uring_source_open fails.
+*/
+void uring_source_close(struct uring_source *source);